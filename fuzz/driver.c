@@ -0,0 +1,273 @@
+/**
+ * @file driver.c
+ * @brief Lanceur autonome des harnais de fuzzing (sans libFuzzer)
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Chaque harnais définit LLVMFuzzerTestOneInput(). Avec clang, il se lie
+ * directement à libFuzzer (-fsanitize=fuzzer, sans ce fichier). Sinon ce
+ * lanceur le fait tourner:
+ *   fuzz_layout fichier...          rejoue des entrées (crash, corpus)
+ *   fuzz_layout < entrée            une entrée sur stdin (afl-fuzz)
+ *   fuzz_layout -r N [-s GRAINE] corpus/...
+ *                                   N mutations aléatoires du corpus
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define DRIVER_MAX_INPUT  16384
+#define DRIVER_MAX_SEEDS  256
+#define DRIVER_CRASH_FILE "crash-input"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* Rapport d'erreur d'ASan/UBSan: appelé avant de quitter */
+void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+/* Morceaux insérés par le mutateur: balises, UTF-8 valide et invalide */
+static const char *const tokens[] = {
+    "{dbl}", "{dh}", "{dw}", "{inv}", "{/inv}", "{blink}", "{/blink}", "{c:3}", "{f:5}",
+    "{c:9}", "{/}", "{{", "{", "}", "\n", "\n\n", " ", "é", "à", "ç", "Ê", "€", "œ", "«",
+    "\xC3", "\xC0\x80", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xFF",
+    "\x1B", "\x0C", "\x1F", "\x12", "\x19\x41",
+};
+
+static uint8_t *seeds[DRIVER_MAX_SEEDS];
+static size_t seed_sizes[DRIVER_MAX_SEEDS];
+static int nseeds = 0;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+/* Entrée mutée en cours, gardée si le harnais échoue */
+static const uint8_t *current_data;
+static size_t current_size;
+
+/**
+ * @brief Générateur xorshift64* (reproductible avec -s)
+ */
+static uint64_t rng(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Écrit l'entrée mutée en cours dans DRIVER_CRASH_FILE
+ * 
+ * Appelé depuis un gestionnaire de signal: open() et write() seulement.
+ */
+static void save_current(void) {
+    static const char msg[] = "Entrée fautive écrite dans " DRIVER_CRASH_FILE "\n";
+    ssize_t written;
+    int fd;
+
+    if (current_data == NULL) {
+        return;
+    }
+    fd = open(DRIVER_CRASH_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        written = write(fd, current_data, current_size);
+        close(fd);
+        if (written == (ssize_t)current_size) {
+            written = write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        }
+        (void)written;
+    }
+    current_data = NULL;
+}
+
+/**
+ * @brief abort() ou faute dans le harnais: garde l'entrée puis quitte
+ */
+static void crash_handler(int sig) {
+    save_current();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * @brief Lit un fichier entier (tronqué à DRIVER_MAX_INPUT)
+ */
+static uint8_t *read_input(FILE *file, size_t *size) {
+    uint8_t *data = malloc(DRIVER_MAX_INPUT);
+
+    if (data == NULL) {
+        return NULL;
+    }
+    *size = fread(data, 1, DRIVER_MAX_INPUT, file);
+    return data;
+}
+
+/**
+ * @brief Ajoute un fichier (ou le contenu d'un répertoire) aux entrées
+ */
+static void add_path(const char *path) {
+    struct stat st;
+    FILE *file;
+
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "%s: introuvable\n", path);
+        exit(2);
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        char child[1024];
+
+        while (dir != NULL && (entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+                add_path(child);
+            }
+        }
+        if (dir != NULL) {
+            closedir(dir);
+        }
+        return;
+    }
+
+    if (nseeds == DRIVER_MAX_SEEDS || (file = fopen(path, "rb")) == NULL) {
+        return;
+    }
+    seeds[nseeds] = read_input(file, &seed_sizes[nseeds]);
+    fclose(file);
+    if (seeds[nseeds] != NULL) {
+        nseeds++;
+    }
+}
+
+/**
+ * @brief Applique quelques mutations aléatoires à buf
+ */
+static size_t mutate(uint8_t *buf, size_t size) {
+    int count = 1 + (int)(rng() % 8);
+
+    for (int i = 0; i < count; i++) {
+        size_t pos = size ? rng() % (size + 1) : 0;
+
+        switch (rng() % 5) {
+            case 0:  // bit inversé
+                if (size > 0) {
+                    buf[pos % size] ^= (uint8_t)(1 << (rng() % 8));
+                }
+                break;
+            case 1: {  // octet quelconque inséré
+                if (size < DRIVER_MAX_INPUT) {
+                    memmove(buf + pos + 1, buf + pos, size - pos);
+                    buf[pos] = (uint8_t)rng();
+                    size++;
+                }
+                break;
+            }
+            case 2: {  // balise ou séquence UTF-8 insérée
+                const char *token = tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))];
+                size_t len = strlen(token);
+                if (size + len <= DRIVER_MAX_INPUT) {
+                    memmove(buf + pos + len, buf + pos, size - pos);
+                    memcpy(buf + pos, token, len);
+                    size += len;
+                }
+                break;
+            }
+            case 3: {  // plage retirée
+                size_t len = size > pos ? rng() % (size - pos + 1) % 64 : 0;
+                memmove(buf + pos, buf + pos + len, size - pos - len);
+                size -= len;
+                break;
+            }
+            default: {  // morceau dupliqué
+                size_t len = size > pos ? rng() % (size - pos + 1) % 256 : 0;
+                if (size + len <= DRIVER_MAX_INPUT) {
+                    memmove(buf + pos + len, buf + pos, size - pos);
+                    size += len;
+                }
+                break;
+            }
+        }
+    }
+    return size;
+}
+
+int main(int argc, char *argv[]) {
+    long runs = 0;
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-r") == 0 && first + 1 < argc) {
+            runs = atol(argv[first + 1]);
+        } else if (strcmp(argv[first], "-s") == 0 && first + 1 < argc) {
+            rng_state = strtoull(argv[first + 1], NULL, 0);
+            if (rng_state == 0) {
+                rng_state = 1;  // xorshift reste à zéro
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [-r N] [-s GRAINE] [fichier|répertoire...]\n", argv[0]);
+            return 2;
+        }
+        first += 2;
+    }
+
+    for (int i = first; i < argc; i++) {
+        add_path(argv[i]);
+    }
+
+    // Sans fichier: une seule entrée sur stdin (mode afl-fuzz)
+    if (first == argc) {
+        size_t size;
+        uint8_t *data = read_input(stdin, &size);
+        if (data == NULL) {
+            return 1;
+        }
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+        return 0;
+    }
+
+    for (int s = 0; s < nseeds; s++) {
+        LLVMFuzzerTestOneInput(seeds[s], seed_sizes[s]);
+    }
+
+    if (runs > 0) {
+        uint8_t *buf = malloc(DRIVER_MAX_INPUT);
+        uint64_t seed = rng_state;
+
+        if (buf == NULL) {
+            return 1;
+        }
+        signal(SIGABRT, crash_handler);
+        signal(SIGSEGV, crash_handler);
+        if (__sanitizer_set_death_callback != NULL) {
+            __sanitizer_set_death_callback(save_current);
+        }
+        for (long r = 0; r < runs; r++) {
+            size_t size = 0;
+            if (nseeds > 0) {
+                int s = (int)(rng() % (uint64_t)nseeds);
+                size = seed_sizes[s];
+                memcpy(buf, seeds[s], size);
+            }
+            size = mutate(buf, size);
+            current_data = buf;
+            current_size = size;
+            LLVMFuzzerTestOneInput(buf, size);
+        }
+        current_data = NULL;
+        fprintf(stderr, "%s: %ld mutation(s) sans erreur (graine %#llx)\n", argv[0], runs,
+                (unsigned long long)seed);
+        free(buf);
+    }
+
+    for (int s = 0; s < nseeds; s++) {
+        free(seeds[s]);
+    }
+    return 0;
+}
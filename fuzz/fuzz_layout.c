@@ -0,0 +1,82 @@
+/**
+ * @file fuzz_layout.c
+ * @brief Harnais de fuzzing: mise en page et encodeur de pages
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Test différentiel sans Minitel: chaque page de layout_pages() est
+ * encodée par encode_frame() à partir de l'écran simulé, puis les octets
+ * sont relus par le décodeur Vidéotex du modèle d'écran. L'écran obtenu
+ * doit être exactement la page voulue, cellule par cellule. La mise en
+ * page refaite dans une arène (comme content_load) doit donner les mêmes
+ * pages que sur le tas.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../minitel.h"
+
+/**
+ * @brief Compare l'écran simulé à la page voulue
+ */
+static void check_screen(const minitel_screen_t *sim, const screen_cells_t *page, int p) {
+    for (int idx = 0; idx < SCREEN_CELLS; idx++) {
+        if (sim->cells.ch[idx] != page->ch[idx] || sim->cells.g2[idx] != page->g2[idx]
+            || sim->cells.attr[idx] != page->attr[idx]) {
+            fprintf(stderr, "page %d, rangée %d, colonne %d: écran %#04x/%#04x/%#06x, attendu %#04x/%#04x/%#06x\n",
+                    p + 1, idx / SCREEN_COLS, idx % SCREEN_COLS,
+                    sim->cells.ch[idx], sim->cells.g2[idx], sim->cells.attr[idx],
+                    page->ch[idx], page->g2[idx], page->attr[idx]);
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static uint8_t frame[FRAME_MAX_BYTES];
+    screen_cells_t *pages = NULL;
+    screen_cells_t *arena_pages = NULL;
+    arena_t arena = { 0 };
+    minitel_screen_t sim;
+    size_t stream_len;
+    int npages = layout_pages(NULL, (const char *)data, size, &pages);
+
+    if (npages < 0) {
+        return 0;
+    }
+
+    if (layout_pages(&arena, (const char *)data, size, &arena_pages) != npages
+        || (npages > 0 && memcmp(arena_pages, pages, (size_t)npages * sizeof(screen_cells_t)) != 0)
+        || compile_markup(&arena, (const char *)data, size, &stream_len) == NULL) {
+        fprintf(stderr, "layout_pages: pages différentes dans une arène\n");
+        abort();
+    }
+    arena_free(&arena);
+
+    // Pages enchaînées, comme en mode page: chaque encodage part de l'écran
+    // laissé par le précédent (envoi différentiel ou effacement complet)
+    screen_reset(&sim);
+    for (int p = 0; p < npages; p++) {
+        size_t len = encode_frame(&sim, &pages[p], frame);
+
+        if (len > FRAME_MAX_BYTES) {
+            fprintf(stderr, "page %d: %zu octets encodés, plus que FRAME_MAX_BYTES\n", p + 1, len);
+            abort();
+        }
+        screen_feed(&sim, frame, len);
+        check_screen(&sim, &pages[p], p);
+    }
+
+    // Retour à la première page: encodage différentiel depuis la dernière
+    if (npages > 1) {
+        size_t len = encode_frame(&sim, &pages[0], frame);
+        screen_feed(&sim, frame, len);
+        check_screen(&sim, &pages[0], 0);
+    }
+
+    free(pages);
+    return 0;
+}
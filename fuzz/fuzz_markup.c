@@ -0,0 +1,138 @@
+/**
+ * @file fuzz_markup.c
+ * @brief Harnais de fuzzing: balises de mise en forme et flux du mode défilement
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Le flux de compile_markup() est relu par le décodeur Vidéotex du modèle
+ * d'écran: chaque octet visible doit être celui du texte (balises
+ * retirées) et arriver avec les attributs que les balises demandent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../minitel.h"
+
+/* Bits d'attributs qu'une balise peut toucher */
+#define MARKUP_ATTRS (ATTR_FG_MASK | ATTR_BG_MASK | ATTR_BLINK | ATTR_INVERSE | ATTR_DBL_HEIGHT | ATTR_DBL_WIDTH)
+
+/**
+ * @brief Vérifie markup_tag() à chaque position du texte
+ */
+static void check_tags(const char *text, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        uint16_t attr = ATTR_DEFAULT;
+        size_t n = markup_tag(text + i, size - i, &attr);
+
+        if (n == 0) {
+            if (attr != ATTR_DEFAULT) {
+                fprintf(stderr, "markup_tag: octet %zu: attributs modifiés sans balise\n", i);
+                abort();
+            }
+            continue;
+        }
+        if (n > size - i || n < 3 || text[i] != '{' || text[i + n - 1] != '}'
+            || memchr(text + i, '}', n - 1) != NULL || (attr & ~MARKUP_ATTRS) != 0) {
+            fprintf(stderr, "markup_tag: octet %zu: balise de %zu octet(s), attributs %#06x\n", i, n, attr);
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const char *text = (const char *)data;
+    uint8_t *expected = malloc(size + 1);
+    uint16_t *expected_attr = malloc((size + 1) * sizeof(uint16_t));
+    uint16_t want = ATTR_DEFAULT;
+    uint16_t last = ATTR_DEFAULT;
+    minitel_screen_t sim;
+    uint8_t *out;
+    size_t out_len;
+    size_t nexpected = 0;
+    size_t k = 0;
+
+    if (expected == NULL || expected_attr == NULL) {
+        free(expected);
+        free(expected_attr);
+        return 0;
+    }
+
+    check_tags(text, size);
+
+    // Référence: octets visibles et attributs voulus, d'après les balises
+    for (size_t i = 0; i < size; i++) {
+        uint8_t b = data[i];
+
+        if (b == '{' && i + 1 < size && data[i + 1] == '{') {
+            i++;
+        } else if (b == '{') {
+            size_t tag = markup_tag(text + i, size - i, &want);
+            if (tag > 0) {
+                i += tag - 1;
+                continue;
+            }
+        } else if (b == '\n') {
+            want = ATTR_DEFAULT;
+            continue;
+        } else if (b == '\r') {
+            continue;
+        } else if (b == '\t') {
+            b = ' ';
+        } else if (b < 0x20 || b == 0x7F) {
+            b = '?';
+        }
+
+        // Suite d'une séquence UTF-8: mêmes attributs que son premier octet
+        if ((b & 0xC0) != 0x80) {
+            last = want;
+        }
+        expected[nexpected] = b;
+        expected_attr[nexpected] = last;
+        nexpected++;
+    }
+
+    out = compile_markup(NULL, text, size, &out_len);
+    if (out == NULL) {
+        free(expected);
+        free(expected_attr);
+        return 0;
+    }
+
+    // Relecture: les séquences ESC passent par le décodeur du modèle d'écran
+    screen_reset(&sim);
+    for (size_t j = 0; j < out_len; j++) {
+        uint8_t b = out[j];
+
+        if (b == 0x1B) {
+            if (j + 1 >= out_len) {
+                fprintf(stderr, "compile_markup: ESC en fin de flux\n");
+                abort();
+            }
+            screen_feed(&sim, out + j, 2);
+            j++;
+            continue;
+        }
+        if (b < 0x20 || b == 0x7F) {
+            fprintf(stderr, "compile_markup: octet %zu: caractère de commande %#04x dans le flux\n", j, b);
+            abort();
+        }
+        if (k >= nexpected || b != expected[k] || sim.cur_attr != expected_attr[k]) {
+            fprintf(stderr, "compile_markup: octet %zu: %#04x attributs %#06x, attendu %#04x attributs %#06x\n",
+                    j, b, sim.cur_attr, k < nexpected ? expected[k] : 0, k < nexpected ? expected_attr[k] : 0);
+            abort();
+        }
+        k++;
+    }
+    if (k != nexpected) {
+        fprintf(stderr, "compile_markup: %zu octet(s) visibles, attendu %zu\n", k, nexpected);
+        abort();
+    }
+
+    free(out);
+    free(expected);
+    free(expected_attr);
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file fuzz_output.c
+ * @brief Harnais de fuzzing: fil d'écriture sous fautes injectées
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Le port est un tube non bloquant, comme le port série. Les quatre
+ * premiers octets de l'entrée règlent port_faults_set() (EAGAIN, EINTR,
+ * écritures tronquées, ports muets, parfois EIO), le reste part deux
+ * fois: par l'anneau (output_queue), puis en segments rejoués par
+ * writev() (output_replay),
+ * découpés selon les octets eux-mêmes. Sans EIO, le tube doit recevoir
+ * exactement ces octets; avec EIO, un début de ces octets, puis le port
+ * est abandonné comme lors d'un débranchement.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../minitel.h"
+
+#define OUTPUT_MAX_PAYLOAD 256
+
+static minitel_t m;
+static int port[2] = { -1, -1 };
+
+/**
+ * @brief Contexte et fil d'écriture partagés par toutes les entrées
+ */
+static void setup(void) {
+    // Chaque réglage des fautes est journalisé: rien sur stdout
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        abort();
+    }
+    log_set_file("/dev/null");
+    if (minitel_init(&m) < 0 || output_init(&m, 0) < 0 || pipe2(port, O_CLOEXEC) < 0) {
+        fprintf(stderr, "fuzz_output: initialisation impossible\n");
+        abort();
+    }
+    m.metrics_file[0] = '\0';
+    fcntl(port[0], F_SETFL, O_NONBLOCK);
+    fcntl(port[1], F_SETFL, O_NONBLOCK);  // comme le port série
+}
+
+/**
+ * @brief Vide le tube dans buf
+ */
+static size_t drain(uint8_t *buf, size_t cap) {
+    size_t got = 0;
+    ssize_t n;
+
+    while (got < cap && (n = read(port[0], buf + got, cap - got)) > 0) {
+        got += (size_t)n;
+    }
+    return got;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static uint8_t expected[2 * OUTPUT_MAX_PAYLOAD + 1];
+    static uint8_t received[2 * OUTPUT_MAX_PAYLOAD + 1];
+    static output_segment_t segs[OUTPUT_MAX_PAYLOAD];
+    const uint8_t *payload = data + 4;
+    size_t len = size - 4;
+    uint64_t sent = 0;
+    size_t got;
+    char spec[160];
+    int count = 0;
+    int lost;
+
+    if (size < 4) {
+        return 0;
+    }
+    if (port[1] < 0) {
+        setup();
+    }
+    if (len > OUTPUT_MAX_PAYLOAD) {
+        len = OUTPUT_MAX_PAYLOAD;
+    }
+
+    snprintf(spec, sizeof(spec), "eio=%s,eagain=%d,eintr=%d,partial=%g,stall=%s,stall_ms=1,seed=%u",
+             data[0] & 0x80 ? "0.2" : "0", (data[0] & 7) * 4, ((data[0] >> 3) & 7) * 4, (data[1] & 15) * 2.5,
+             data[1] & 0x10 ? "0.5" : "0", (unsigned)(data[2] | data[3] << 8));
+    if (port_faults_set(&m, spec) < 0) {
+        fprintf(stderr, "port_faults_set: réglage refusé: %s\n", spec);
+        abort();
+    }
+
+    // Segments de 1 à 48 octets, un sur deux cadencé
+    for (size_t i = 0; i < len; count++) {
+        uint32_t take = 1 + payload[i] % 48;
+        if (take > len - i) {
+            take = (uint32_t)(len - i);
+        }
+        segs[count].base = payload + i;
+        segs[count].len = take;
+        segs[count].flags = count % 2 ? 0 : SEGMENT_PACED;
+        i += take;
+    }
+
+    m.fd = port[1];
+    m.reconnect = 0;
+    if (output_queue(&m, payload, len, 0) == 0) {
+        output_flush(&m);
+    }
+    output_replay(&m, segs, count, 0, &sent);
+    lost = m.reconnect;
+    got = drain(received, sizeof(received));
+
+    memcpy(expected, payload, len);
+    memcpy(expected + len, payload, len);
+    if (got > 2 * len || memcmp(received, expected, got) != 0) {
+        fprintf(stderr, "fil d'écriture: %zu octets reçus ne correspondent pas à l'envoi (%s)\n", got, spec);
+        abort();
+    }
+    if (!lost && (got != 2 * len || sent != len)) {
+        fprintf(stderr, "fil d'écriture: %zu/%zu octets reçus, %llu/%zu rejoués, sans erreur fatale (%s)\n",
+                got, 2 * len, (unsigned long long)sent, len, spec);
+        abort();
+    }
+    if (lost && !(data[0] & 0x80)) {
+        fprintf(stderr, "fil d'écriture: port perdu sans EIO injecté (%s)\n", spec);
+        abort();
+    }
+
+    // Port perdu: la file est abandonnée, comme avant une reconnexion
+    output_detach(&m);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file fuzz_utf8.c
+ * @brief Harnais de fuzzing: décodeur UTF-8 et table des glyphes Vidéotex
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Comparaison différentielle de utf8_decode() avec un décodeur de
+ * référence écrit d'après la table 3-7 d'Unicode (séquences bien formées):
+ * même longueur consommée, même point de code, U+FFFD sur tout le reste.
+ * utf8_sanitize() (plages ASCII sautées par blocs) doit remplacer
+ * exactement les octets que la référence refuse.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../minitel.h"
+
+/**
+ * @brief Décodeur de référence: plages d'octets de la table 3-7
+ */
+static int reference_decode(const unsigned char *s, size_t len, uint32_t *cp) {
+    unsigned char lo = 0x80, hi = 0xBF;
+    int n;
+    uint32_t c;
+
+    if (s[0] < 0x80) {
+        *cp = s[0];
+        return 1;
+    } else if (s[0] >= 0xC2 && s[0] <= 0xDF) {
+        n = 2;
+        c = s[0] & 0x1F;
+    } else if (s[0] >= 0xE0 && s[0] <= 0xEF) {
+        n = 3;
+        c = s[0] & 0x0F;
+        if (s[0] == 0xE0) lo = 0xA0;
+        if (s[0] == 0xED) hi = 0x9F;
+    } else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+        n = 4;
+        c = s[0] & 0x07;
+        if (s[0] == 0xF0) lo = 0x90;
+        if (s[0] == 0xF4) hi = 0x8F;
+    } else {
+        *cp = 0xFFFD;
+        return 1;
+    }
+
+    if ((size_t)n > len || s[1] < lo || s[1] > hi) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    for (int i = 1; i < n; i++) {
+        if (i > 1 && (s[i] < 0x80 || s[i] > 0xBF)) {
+            *cp = 0xFFFD;
+            return 1;
+        }
+        c = (c << 6) | (s[i] & 0x3F);
+    }
+
+    *cp = c;
+    return n;
+}
+
+/**
+ * @brief utf8_sanitize() (blocs SIMD) face au remplacement octet par octet
+ */
+static void check_sanitize(const uint8_t *data, size_t size) {
+    char *text = malloc(size + 1);
+    size_t expected = 0;
+    size_t first = 0;
+    size_t replaced;
+
+    if (text == NULL) {
+        return;
+    }
+    memcpy(text, data, size);
+    replaced = utf8_sanitize(text, size, &first);
+
+    for (size_t i = 0; i < size;) {
+        uint32_t cp;
+        int n = reference_decode(data + i, size - i, &cp);
+
+        if (n == 1 && data[i] >= 0x80) {
+            if (text[i] != '?' || (expected == 0 && first != i)) {
+                fprintf(stderr, "utf8_sanitize: octet %zu invalide non remplacé\n", i);
+                abort();
+            }
+            expected++;
+        } else if (memcmp(text + i, data + i, (size_t)n) != 0) {
+            fprintf(stderr, "utf8_sanitize: octet %zu valide modifié\n", i);
+            abort();
+        }
+        i += (size_t)n;
+    }
+    if (replaced != expected) {
+        fprintf(stderr, "utf8_sanitize: %zu octet(s) remplacé(s), attendu %zu\n", replaced, expected);
+        abort();
+    }
+
+    free(text);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    size_t i = 0;
+
+    check_sanitize(data, size);
+
+    while (i < size) {
+        uint32_t cp, ref;
+        int n = utf8_decode(data + i, size - i, &cp);
+        int ref_n = reference_decode(data + i, size - i, &ref);
+        uint16_t glyph = videotex_glyph(cp);
+        uint8_t ch = (uint8_t)(glyph & 0xFF);
+        uint8_t g2 = (uint8_t)(glyph >> 8);
+
+        if (n != ref_n || cp != ref) {
+            fprintf(stderr, "utf8_decode: octet %zu: %d octet(s) U+%04X, attendu %d octet(s) U+%04X\n",
+                    i, n, (unsigned)cp, ref_n, (unsigned)ref);
+            abort();
+        }
+
+        // Un glyphe est un caractère G0 imprimable, éventuellement précédé
+        // d'un code G2, ou un code G2 seul (œ, ß...)
+        if (!(ch >= 0x20 && ch < 0x7F) && !(ch == 0 && g2 >= 0x20 && g2 < 0x80)) {
+            fprintf(stderr, "videotex_glyph(U+%04X) = %#06x: pas affichable\n", (unsigned)cp, glyph);
+            abort();
+        }
+        if (g2 != 0 && (g2 < 0x20 || g2 >= 0x80)) {
+            fprintf(stderr, "videotex_glyph(U+%04X) = %#06x: code G2 invalide\n", (unsigned)cp, glyph);
+            abort();
+        }
+
+        i += (size_t)n;
+    }
+
+    return 0;
+}
@@ -0,0 +1,5578 @@
+/**
+ * @file libminitel.c
+ * @brief libminitel: port série, encodeur Vidéotex, mise en page et cadencement
+ * @author Creative Coding 2026
+ * @date 2026
+ * 
+ * Moteur du programme minitel, réutilisable par d'autres outils: voir
+ * minitel.h pour l'API. Chaque Minitel piloté a son contexte (minitel_t),
+ * avec sa boucle d'événements et son fil d'écriture.
+ */
+
+/* pthread_setaffinity_np() et CPU_SET() (realtime_setup) */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <signal.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+/* Définir _DEFAULT_SOURCE pour cfmakeraw */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include "minitel.h"
+
+/* Port série */
+#define BAUDRATE        B4800
+
+/* Identification du terminal à la connexion */
+#define PROBE_TIMEOUT_MS 500
+#define PROBE_CACHE_SIZE 4
+
+/* Mode page */
+#define ANIM_MAX_FRAMES 256
+#define ANIM_MAX_FPS    25
+#define INDEX_MAX_ENTRIES 18
+
+/* Boucle d'événements */
+#define KEY_QUEUE_SIZE  16
+#define EVENT_MAX_WATCHES 4    // descripteurs ajoutés par l'appelant (event_loop_watch)
+#define SCREEN_DUMP_FILE "/tmp/minitel.screen"
+#define METRICS_INTERVAL 10
+
+/* Cadencement et calibrage */
+#define PACE_MAX_LAG    8      // retard (en créneaux) au-delà duquel on se recale
+#define CALIB_BYTES     480    // octets envoyés par palier
+#define CALIB_QUEUE_SLACK 16   // file de sortie tolérée en fin de palier
+#define CALIB_MARGIN_PCT 5     // marge ajoutée au délai retenu
+
+/* Sortie: anneau entre l'encodeur (fil principal) et le fil d'écriture */
+#define OUTPUT_RING_SIZE 8192       // éléments, puissance de 2
+#define OUTPUT_PACED     0x100      // l'octet occupe un créneau de cadencement
+#define OUTPUT_POLL_MS   1000       // attente maximale du port avant de revérifier
+#define OUTPUT_WAIT_US   100000     // attente maximale de l'encodeur avant de revérifier
+#define OUTPUT_STALL_US  5000000L   // écriture sans progrès au-delà: port bloqué
+#define OUTPUT_MIRROR_MS 50         // un miroir qui n'accepte rien pendant ce délai est retiré
+#define OUTPUT_BATCH     256        // octets non cadencés par écriture depuis l'anneau
+#define SERIAL_FIFO_BYTES 16        // FIFO de l'UART, que TIOCOUTQ ne compte pas
+#define URING_BATCH      32         // octets par soumission io_uring
+#define URING_ENTRIES    1024       // (1 + miroirs) * URING_BATCH chaînes de 3 SQE
+#define URING_RETRIES    8          // reprises sans progrès avant de revenir à poll()
+#define REPLAY_IOV_MAX   64         // segments par writev() lors d'un passage rejoué
+#define SEGMENT_FEEDS    32         // sauts de ligne de fin par segment
+
+/* Arènes de contenu */
+#define ARENA_BLOCK      (256 * 1024)   // taille minimale d'un bloc projeté
+#define ARENA_ALIGN      16
+#define ARENA_PAGE       4096
+
+/* Temps réel (realtime_setup) */
+#define RT_PREFAULT_STACK (256 * 1024)
+
+/**
+ * @brief Page pré-encodée à partir de l'écran courant
+ */
+typedef struct {
+    uint8_t bytes[FRAME_MAX_BYTES];
+    size_t len;
+    int page;               // -1 si vide
+    uint64_t stamp;         // m->screen.bytes au moment de l'encodage
+} prepared_frame_t;
+
+/* Modèles connus (2e octet de la réponse ENQROM) */
+static const struct {
+    uint8_t code;
+    const char *name;
+    int max_speed;
+    int cols80;
+    int drcs;
+} minitel_models[] = {
+    { 'b', "Minitel 1", 1200, 0, 0 },
+    { 'c', "Minitel 1", 1200, 0, 0 },
+    { 'd', "Minitel 10", 1200, 0, 0 },
+    { 'e', "Minitel 1 couleur", 1200, 0, 0 },
+    { 'f', "Minitel 10", 1200, 0, 0 },
+    { 'g', "Émulateur", 9600, 1, 1 },
+    { 'j', "Imprimante", 1200, 0, 0 },
+    { 'r', "Minitel 1", 1200, 0, 0 },
+    { 's', "Minitel 1 couleur", 1200, 0, 0 },
+    { 't', "Terminatel 252", 1200, 0, 0 },
+    { 'u', "Minitel 1B", 4800, 1, 0 },
+    { 'v', "Minitel 2", 9600, 1, 1 },
+    { 'w', "Minitel 10B", 4800, 1, 0 },
+    { 'y', "Minitel 5", 9600, 1, 1 },
+    { 'z', "Minitel 12", 9600, 1, 1 },
+};
+
+/* États du décodeur Vidéotex */
+enum {
+    VT_NORMAL,
+    VT_ESC,
+    VT_SKIP,
+    VT_US_ROW,
+    VT_US_COL,
+    VT_SS2,
+    VT_SS2_ACCENT,
+    VT_REP
+};
+
+/**
+ * @brief Anneau producteur unique / consommateur unique, sans verrou
+ * 
+ * Chaque élément est un octet à émettre, plus OUTPUT_PACED s'il occupe un
+ * créneau. head n'est écrit que par l'encodeur, tail que par le fil
+ * d'écriture; les indices croissent sans fin et sont masqués à l'accès.
+ */
+typedef struct {
+    uint16_t slots[OUTPUT_RING_SIZE];
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+} output_ring_t;
+
+#ifdef HAVE_IO_URING
+/**
+ * @brief Anneaux io_uring partagés avec le noyau (appels système bruts, sans liburing)
+ * 
+ * Les tampons d'une rafale restent en place jusqu'à ses complétions.
+ */
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned queued;        // SQE préparées, pas encore soumises
+    uint8_t bytes[URING_BATCH];
+    struct __kernel_timespec slots[URING_BATCH];
+    struct __kernel_timespec write_limit, mirror_limit;
+    int results[1 + OUTPUT_MAX_MIRRORS][URING_BATCH];
+} uring_t;
+
+/* Types d'opérations, dans les bits hauts de user_data */
+#define URING_OP_WRITE   1ULL
+#define URING_OP_TIMEOUT 2ULL
+#endif
+
+/**
+ * @brief Position dans une liste de segments: tout l'état d'un passage rejoué
+ */
+typedef struct {
+    int seg;
+    uint32_t off;
+    uint64_t bytes;         // octets déjà parcourus
+} replay_cursor_t;
+
+/**
+ * @brief Fautes injectées sur le port principal (port_faults_set), en millionièmes
+ * 
+ * Chaque appel tire dans rng par une addition atomique: l'encodeur et le
+ * fil d'écriture peuvent tirer en même temps.
+ */
+typedef struct {
+    uint32_t eio;           // erreur fatale: reconnexion
+    uint32_t eagain;
+    uint32_t eintr;
+    uint32_t partial;       // écriture tronquée
+    uint32_t stall;         // port muet pendant stall_ms
+    int stall_ms;
+    _Atomic uint64_t rng;
+} port_faults_t;
+
+/**
+ * @brief Entrées-sorties du port principal: appels système, ou fautes injectées
+ */
+typedef struct {
+    const char *name;
+    ssize_t (*writev)(minitel_t *m, int fd, const struct iovec *iov, int iovcnt);
+    int (*poll)(minitel_t *m, struct pollfd *pfd, int timeout_ms);
+} port_io_t;
+
+/**
+ * @brief Descripteur ajouté à la boucle par l'appelant
+ */
+typedef struct {
+    int fd;
+    event_handler_t handler;
+} event_watch_t;
+
+/**
+ * @brief Boucle d'événements et fil d'écriture d'un contexte
+ */
+struct minitel_engine {
+    /* Boucle d'événements: clavier du Minitel et minuteries */
+    int epoll_fd;
+    int pace_timer_fd;
+    int serial_event_fd;
+    int watchdog_timer_fd;
+    int metrics_timer_fd;
+    event_watch_t watches[EVENT_MAX_WATCHES];
+    int nwatches;
+    int key_queue[KEY_QUEUE_SIZE];
+    unsigned int key_head;
+    unsigned int key_tail;
+    uint8_t keyboard_state;
+    /* Pages suivante et précédente, prêtes à partir; tampon d'encodage */
+    prepared_frame_t prepared[2];
+    uint8_t frame[FRAME_MAX_BYTES];
+    /* Fil d'écriture: anneau, réveils (eventfd) et état partagé */
+    output_ring_t output_ring;
+    pthread_t writer_thread;
+    int writer_started;
+    int writer_wake_fd;                 // encodeur -> fil d'écriture: données disponibles
+    int output_wake_fd;                 // fil d'écriture -> boucle: place libérée, file vide
+    _Atomic int output_fd;
+    _Atomic int output_mirrors[OUTPUT_MAX_MIRRORS];  // -1: libre ou retiré
+    int mirror_fds[OUTPUT_MAX_MIRRORS]; // ouverts par mirrors_open()
+    _Atomic long output_delay;
+    _Atomic int writer_idle;
+    _Atomic int writer_stop;
+    _Atomic int output_waiting;         // l'encodeur attend un réveil
+    _Atomic int output_discard;         // jeter la file (port perdu)
+    _Atomic int64_t writer_progress_us;
+    pacer_t writer_burst;               // bilan de la dernière rafale, publié avec writer_idle
+    const output_segment_t *_Atomic replay;  // passage à rejouer (output_replay), NULL sinon
+    int replay_count;
+    _Atomic uint64_t replay_done;       // octets du passage écrits sur le port
+    _Atomic int replay_stop;
+    /* Port principal: appels système (io_sys) ou fautes injectées */
+    const port_io_t *io;
+    struct timespec started;            // lancement du processus (CLOCK_MONOTONIC)
+    _Atomic size_t first_glyph_at;      // l'anneau contient le premier caractère avant cette position, 0: rien en attente
+    port_faults_t faults;
+#ifdef HAVE_IO_URING
+    uring_t uring;
+#endif
+};
+
+/* Journal: ouvert au premier message, rouvert après log_set_file() (SIGHUP) */
+static char log_path[256] = LOG_FILE;
+static int log_fd = -1;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Résultats de la sonde par port (reconnexions) */
+static terminal_caps_t probe_cache[PROBE_CACHE_SIZE];
+
+/* Octets projetés par toutes les arènes, et plus haut niveau atteint */
+static _Atomic size_t arena_total;
+static _Atomic size_t arena_peak;
+
+/* Notification systemd (Type=notify): socket et période du watchdog */
+static int notify_fd = -1;
+static long watchdog_usec = 0;
+
+/**
+ * @brief Change le fichier de log (LOG_FILE par défaut)
+ * 
+ * Le fichier est rouvert au message suivant: rappelé à chaque relecture
+ * de la configuration, il suit aussi un journal déplacé par une rotation.
+ */
+void log_set_file(const char *path) {
+    pthread_mutex_lock(&log_lock);
+    if (log_fd >= 0) {
+        close(log_fd);
+        log_fd = -1;
+    }
+    snprintf(log_path, sizeof(log_path), "%s", path);
+    pthread_mutex_unlock(&log_lock);
+}
+
+/**
+ * @brief Écrit dans le fichier de log avec timestamp
+ * 
+ * Une ligne, un write() sur un descripteur gardé ouvert (O_APPEND): pas
+ * d'ouverture par message, et les lignes de plusieurs fils ne se mêlent pas.
+ */
+void log_message(const char *level, const char *message) {
+    time_t now;
+    struct tm tm;
+    char timestamp[64];
+    char line[1024];
+    int len;
+    
+    time(&now);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime_r(&now, &tm));
+    len = snprintf(line, sizeof(line), "[%s] %s: %s\n", timestamp, level, message);
+    if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+    
+    pthread_mutex_lock(&log_lock);
+    if (log_fd < 0) {
+        log_fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+    }
+    if (log_fd >= 0 && write(log_fd, line, (size_t)len) < 0) {
+        close(log_fd);  // disque plein, fichier retiré: nouvel essai au message suivant
+        log_fd = -1;
+    }
+    pthread_mutex_unlock(&log_lock);
+    
+    // Afficher aussi sur stdout
+    fwrite(line, 1, (size_t)len, stdout);
+}
+
+/**
+ * @brief Remet le modèle d'écran dans l'état qui suit un 0x0C
+ */
+void screen_reset(minitel_screen_t *scr) {
+    memset(scr->cells.ch, ' ', sizeof(scr->cells.ch));
+    memset(scr->cells.g2, 0, sizeof(scr->cells.g2));
+    for (int i = 0; i < SCREEN_CELLS; i++) {
+        scr->cells.attr[i] = ATTR_DEFAULT;
+    }
+    scr->row = 1;
+    scr->col = 0;
+    scr->cur_attr = ATTR_DEFAULT;
+    scr->state = VT_NORMAL;
+    scr->last_ch = ' ';
+}
+
+/**
+ * @brief Fait avancer le curseur d'une cellule (mode page: retour en rangée 1)
+ */
+static void screen_advance(minitel_screen_t *scr) {
+    scr->col += (scr->cur_attr & ATTR_DBL_WIDTH) ? 2 : 1;
+    if (scr->col >= SCREEN_COLS) {
+        scr->col = 0;
+        if (scr->row > 0) {
+            scr->row = scr->row >= SCREEN_ROWS ? 1 : scr->row + 1;
+        }
+    }
+}
+
+/**
+ * @brief Écrit un caractère à la position du curseur
+ */
+static void screen_put(minitel_screen_t *scr, uint8_t ch, uint8_t g2) {
+    int idx = scr->row * SCREEN_COLS + scr->col;
+    uint16_t a = scr->cur_attr;
+    
+    scr->cells.ch[idx] = ch;
+    scr->cells.g2[idx] = g2;
+    scr->cells.attr[idx] = a;
+    scr->last_ch = ch;
+    scr->glyphs++;
+    
+    // Double format: les cellules couvertes sont notées ch = 0, g2 = 0
+    if ((a & ATTR_DBL_WIDTH) && scr->col + 1 < SCREEN_COLS) {
+        scr->cells.ch[idx + 1] = 0;
+        scr->cells.g2[idx + 1] = 0;
+        scr->cells.attr[idx + 1] = a;
+    }
+    if ((a & ATTR_DBL_HEIGHT) && scr->row > 1) {
+        for (int k = 0; k <= ((a & ATTR_DBL_WIDTH) && scr->col + 1 < SCREEN_COLS ? 1 : 0); k++) {
+            scr->cells.ch[idx - SCREEN_COLS + k] = 0;
+            scr->cells.g2[idx - SCREEN_COLS + k] = 0;
+            scr->cells.attr[idx - SCREEN_COLS + k] = a;
+        }
+    }
+    screen_advance(scr);
+}
+
+/**
+ * @brief Applique un attribut de visualisation reçu après ESC
+ */
+static void screen_escape(minitel_screen_t *scr, uint8_t b) {
+    uint16_t a = scr->cur_attr;
+    
+    if (b >= 0x40 && b <= 0x47) {
+        a = (uint16_t)((a & ~ATTR_FG_MASK) | (b - 0x40));
+    } else if (b >= 0x50 && b <= 0x57) {
+        a = (uint16_t)((a & ~ATTR_BG_MASK) | ((b - 0x50) << ATTR_BG_SHIFT));
+    } else if (b == 0x48) {
+        a |= ATTR_BLINK;
+    } else if (b == 0x49) {
+        a &= ~ATTR_BLINK;
+    } else if (b >= 0x4C && b <= 0x4F) {
+        a &= ~(ATTR_DBL_HEIGHT | ATTR_DBL_WIDTH);
+        if (b & 0x01) a |= ATTR_DBL_HEIGHT;
+        if (b & 0x02) a |= ATTR_DBL_WIDTH;
+    } else if (b == 0x5D) {
+        a |= ATTR_INVERSE;
+    } else if (b == 0x5C) {
+        a &= ~ATTR_INVERSE;
+    }
+    
+    scr->cur_attr = a;
+}
+
+/**
+ * @brief Met à jour le modèle d'écran avec des octets émis vers le Minitel
+ * 
+ * Décodeur Vidéotex minimal: caractères G0/G1/G2, positionnement US,
+ * déplacements du curseur, attributs ESC et répétition. Les séquences
+ * protocole (PRO1/2/3) sont consommées sans effet sur l'affichage.
+ */
+void screen_feed(minitel_screen_t *scr, const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = buf[i] & 0x7F;  // liaison 7 bits, le bit 8 est la parité
+        
+        switch (scr->state) {
+            case VT_ESC:
+                scr->state = VT_NORMAL;
+                if (b >= 0x39 && b <= 0x3B) {
+                    scr->skip = b - 0x38;  // PRO1, PRO2, PRO3
+                    scr->state = VT_SKIP;
+                } else {
+                    screen_escape(scr, b);
+                }
+                continue;
+            case VT_SKIP:
+                if (--scr->skip == 0) {
+                    scr->state = VT_NORMAL;
+                }
+                continue;
+            case VT_US_ROW:
+                scr->seq = b;
+                scr->state = VT_US_COL;
+                continue;
+            case VT_US_COL:
+                scr->state = VT_NORMAL;
+                if (scr->seq >= 0x40 && scr->seq <= 0x40 + SCREEN_ROWS && b >= 0x41 && b <= 0x40 + SCREEN_COLS) {
+                    scr->row = scr->seq - 0x40;
+                    scr->col = b - 0x41;
+                    scr->cur_attr = ATTR_DEFAULT;
+                }
+                continue;
+            case VT_SS2:
+                if (b >= 0x41 && b <= 0x4F) {
+                    scr->seq = b;  // accent: la lettre suit
+                    scr->state = VT_SS2_ACCENT;
+                } else {
+                    scr->state = VT_NORMAL;
+                    screen_put(scr, 0, b);
+                }
+                continue;
+            case VT_SS2_ACCENT:
+                scr->state = VT_NORMAL;
+                screen_put(scr, b, scr->seq);
+                continue;
+            case VT_REP:
+                scr->state = VT_NORMAL;
+                for (int k = 0; k < (b & 0x3F); k++) {
+                    screen_put(scr, scr->last_ch, 0);
+                }
+                continue;
+            default:
+                break;
+        }
+        
+        if (b >= 0x20) {
+            if (b == 0x7F) {
+                continue;  // DEL: bourrage
+            }
+            screen_put(scr, b, 0);
+            continue;
+        }
+        
+        switch (b) {
+            case 0x08:  // BS
+                if (--scr->col < 0) {
+                    scr->col = SCREEN_COLS - 1;
+                    scr->row = scr->row <= 1 ? SCREEN_ROWS : scr->row - 1;
+                }
+                break;
+            case 0x09:  // HT
+                screen_advance(scr);
+                break;
+            case 0x0A:  // LF
+                scr->row = scr->row >= SCREEN_ROWS ? 1 : scr->row + 1;
+                break;
+            case 0x0B:  // VT
+                scr->row = scr->row <= 1 ? SCREEN_ROWS : scr->row - 1;
+                break;
+            case 0x0C:  // FF
+                screen_reset(scr);
+                break;
+            case 0x0D:  // CR
+                scr->col = 0;
+                break;
+            case 0x0E:  // SO: jeu G1 semi-graphique
+                scr->cur_attr |= ATTR_G1;
+                break;
+            case 0x0F:  // SI: jeu G0
+                scr->cur_attr &= ~ATTR_G1;
+                break;
+            case 0x11:
+                scr->cursor_visible = 1;
+                break;
+            case 0x14:
+                scr->cursor_visible = 0;
+                break;
+            case 0x12:  // REP
+                scr->state = VT_REP;
+                break;
+            case 0x18:  // CAN: efface jusqu'en fin de rangée
+                for (int c = scr->col; c < SCREEN_COLS; c++) {
+                    int idx = scr->row * SCREEN_COLS + c;
+                    scr->cells.ch[idx] = ' ';
+                    scr->cells.g2[idx] = 0;
+                    scr->cells.attr[idx] = scr->cur_attr;
+                }
+                break;
+            case 0x19:  // SS2
+                scr->state = VT_SS2;
+                break;
+            case 0x1B:
+                scr->state = VT_ESC;
+                break;
+            case 0x1E:  // RS: curseur en haut à gauche
+                scr->row = 1;
+                scr->col = 0;
+                scr->cur_attr = ATTR_DEFAULT;
+                break;
+            case 0x1F:
+                scr->state = VT_US_ROW;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    scr->bytes += len;
+}
+
+/**
+ * @brief Encode les séquences qui font passer des attributs cur à want
+ * @return Nombre d'octets écrits (10 au plus)
+ */
+size_t encode_attr_change(uint16_t cur, uint16_t want, uint8_t *out) {
+    uint16_t diff = want ^ cur;
+    size_t k = 0;
+    
+    if (diff & ATTR_G1) {
+        out[k++] = (want & ATTR_G1) ? 0x0E : 0x0F;
+    }
+    if (diff & ATTR_FG_MASK) {
+        out[k++] = 0x1B;
+        out[k++] = (uint8_t)(0x40 + (want & ATTR_FG_MASK));
+    }
+    if (diff & ATTR_BG_MASK) {
+        out[k++] = 0x1B;
+        out[k++] = (uint8_t)(0x50 + ((want & ATTR_BG_MASK) >> ATTR_BG_SHIFT));
+    }
+    if (diff & ATTR_BLINK) {
+        out[k++] = 0x1B;
+        out[k++] = (want & ATTR_BLINK) ? 0x48 : 0x49;
+    }
+    if (diff & ATTR_INVERSE) {
+        out[k++] = 0x1B;
+        out[k++] = (want & ATTR_INVERSE) ? 0x5D : 0x5C;
+    }
+    if (diff & (ATTR_DBL_HEIGHT | ATTR_DBL_WIDTH)) {
+        out[k++] = 0x1B;
+        out[k++] = (uint8_t)(0x4C | ((want & ATTR_DBL_HEIGHT) ? 1 : 0) | ((want & ATTR_DBL_WIDTH) ? 2 : 0));
+    }
+    
+    return k;
+}
+
+/**
+ * @brief Numéro du seau d'une valeur (µs)
+ */
+static int hist_bucket(uint64_t v) {
+    int e;
+    
+    if (v < HIST_SUB) {
+        return (int)v;
+    }
+    if (v >= (1ULL << HIST_MAX_EXP)) {
+        return HIST_BUCKETS - 1;
+    }
+    e = 63 - __builtin_clzll(v);
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/**
+ * @brief Plus petite valeur (µs) du seau b
+ */
+static uint64_t hist_bucket_low(int b) {
+    if (b < HIST_SUB) {
+        return (uint64_t)b;
+    }
+    int e = b / HIST_SUB + HIST_SUB_BITS - 1;
+    return (uint64_t)(HIST_SUB + b % HIST_SUB) << (e - HIST_SUB_BITS);
+}
+
+/**
+ * @brief Ajoute une mesure (µs) à un histogramme
+ */
+void hist_record(histogram_t *h, uint64_t v) {
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    
+    atomic_fetch_add_explicit(&h->counts[hist_bucket(v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, v, memory_order_relaxed);
+    while (v > max && !atomic_compare_exchange_weak_explicit(&h->max, &max, v,
+                                                             memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Quantile approché (µs): borne basse du seau qui le contient
+ */
+static uint64_t hist_quantile(const histogram_t *h, double q) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint64_t rank = (uint64_t)(q * (double)count);
+    uint64_t seen = 0;
+    
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+        if (seen > rank) {
+            return hist_bucket_low(b);
+        }
+    }
+    return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Écrit un histogramme: seaux cumulés aux puissances de 2, plus quantiles
+ * 
+ * Les seaux fins servent aux quantiles; Prometheus reçoit une borne par
+ * puissance de 2 pour garder un nombre de séries raisonnable.
+ */
+static void metrics_write_histogram(FILE *out, const char *name, const char *help, const histogram_t *h) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    uint64_t cumulative = 0;
+    
+    fprintf(out, "# HELP %s_seconds %s\n# TYPE %s_seconds histogram\n", name, help, name);
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        cumulative += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+        if (b >= HIST_SUB - 1 && (b + 1) % HIST_SUB == 0) {
+            // le est inclusif: la plus grande valeur entière (µs) des seaux comptés
+            fprintf(out, "%s_seconds_bucket{le=\"%.9g\"} %llu\n", name,
+                    (double)(hist_bucket_low(b + 1) - 1) / 1e6, (unsigned long long)cumulative);
+        }
+    }
+    fprintf(out, "%s_seconds_bucket{le=\"+Inf\"} %llu\n", name,
+            (unsigned long long)atomic_load_explicit(&h->count, memory_order_relaxed));
+    fprintf(out, "%s_seconds_sum %.9f\n", name,  // %g arrondirait les incréments d'un long cumul
+            (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e6);
+    fprintf(out, "%s_seconds_count %llu\n", name,
+            (unsigned long long)atomic_load_explicit(&h->count, memory_order_relaxed));
+    
+    fprintf(out, "# HELP %s_quantile_seconds %s (quantiles à ±12,5 %%)\n# TYPE %s_quantile_seconds gauge\n",
+            name, help, name);
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        fprintf(out, "%s_quantile_seconds{quantile=\"%g\"} %g\n", name, quantiles[i],
+                (double)hist_quantile(h, quantiles[i]) / 1e6);
+    }
+    fprintf(out, "%s_quantile_seconds{quantile=\"1\"} %g\n", name,
+            (double)atomic_load_explicit(&h->max, memory_order_relaxed) / 1e6);
+}
+
+/**
+ * @brief Exporte les métriques au format texte Prometheus
+ * 
+ * Écriture atomique (fichier temporaire puis renommage), pour que le
+ * collecteur textfile de node_exporter ne lise jamais un fichier partiel.
+ */
+int metrics_export(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    const char *path = m->metrics_file;
+    char tmp_path[512];
+    FILE *out;
+    int queued = 0;
+    size_t arena_reserved, arena_high;
+    
+    if (path[0] == '\0') {
+        return 0;
+    }
+    
+    arena_stats(&arena_reserved, &arena_high);
+    
+    // Octets encore dans le tampon de sortie du pilote
+    if (e->serial_event_fd >= 0 && ioctl(e->serial_event_fd, TIOCOUTQ, &queued) == 0) {
+        metric_set(&m->metrics.queue_depth, queued);
+    }
+    
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    
+#define COUNTER(name, help, field) \
+    fprintf(out, "# HELP " name " " help "\n# TYPE " name " counter\n" name " %llu\n", \
+            (unsigned long long)atomic_load_explicit(&m->metrics.field, memory_order_relaxed))
+#define GAUGE(name, help, value) \
+    fprintf(out, "# HELP " name " " help "\n# TYPE " name " gauge\n" name " %g\n", (double)(value))
+    
+    COUNTER("minitel_bytes_sent_total", "Octets écrits sur le port série", bytes_sent);
+    COUNTER("minitel_glyphs_sent_total", "Caractères affichés sur le Minitel", glyphs_sent);
+    COUNTER("minitel_passes_total", "Passes complètes du contenu", passes);
+    COUNTER("minitel_pages_sent_total", "Pages envoyées en mode page", pages_sent);
+    COUNTER("minitel_frames_dropped_total", "Images d'animation sautées", frames_dropped);
+    COUNTER("minitel_reconnects_total", "Reconnexions du port série", reconnects);
+    COUNTER("minitel_write_errors_total", "Erreurs d'écriture sur le port série", write_errors);
+    COUNTER("minitel_io_faults_injected_total", "Fautes injectées sur le port (MINITEL_FAULTS)", faults_injected);
+    COUNTER("minitel_pacing_overruns_total", "Octets partis après leur créneau de cadencement", pacing_overruns);
+    GAUGE("minitel_pacing_target_bytes_per_second", "Débit visé par le cadencement (dernière rafale)",
+          atomic_load_explicit(&m->metrics.pacing_target_rate, memory_order_relaxed));
+    GAUGE("minitel_pacing_actual_bytes_per_second", "Débit réellement émis (dernière rafale)",
+          atomic_load_explicit(&m->metrics.pacing_actual_rate, memory_order_relaxed));
+    GAUGE("minitel_pacing_drift_ratio", "Écart relatif du rythme réel sur le rythme visé",
+          atomic_load_explicit(&m->metrics.pacing_drift_ppm, memory_order_relaxed) / 1e6);
+    GAUGE("minitel_output_queue_bytes", "Octets en attente dans le pilote série",
+          atomic_load_explicit(&m->metrics.queue_depth, memory_order_relaxed));
+    GAUGE("minitel_output_ring_bytes", "Octets encodés en attente du fil d'écriture",
+          atomic_load_explicit(&e->output_ring.head, memory_order_relaxed) -
+          atomic_load_explicit(&e->output_ring.tail, memory_order_relaxed));
+    GAUGE("minitel_offset", "Position dans le flux (défilement) ou page affichée (mode page)",
+          atomic_load_explicit(&m->metrics.offset, memory_order_relaxed));
+    GAUGE("minitel_pass_duration_seconds", "Durée de la dernière passe",
+          atomic_load_explicit(&m->metrics.pass_duration_us, memory_order_relaxed) / 1e6);
+    GAUGE("minitel_first_glyph_seconds", "Du lancement du processus au premier caractère affiché (0: pas encore)",
+          atomic_load_explicit(&m->metrics.first_glyph_us, memory_order_relaxed) / 1e6);
+    GAUGE("minitel_terminal_speed_bauds", "Vitesse du terminal connecté", m->terminal.speed);
+    GAUGE("minitel_schedule_open", "1 pendant les horaires d'ouverture, 0 en veille",
+          atomic_load_explicit(&m->metrics.schedule_open, memory_order_relaxed));
+    GAUGE("minitel_content_arena_bytes", "Octets projetés par les arènes des contenus chargés",
+          arena_reserved);
+    GAUGE("minitel_content_arena_peak_bytes", "Plus haut niveau des arènes de contenu depuis le démarrage",
+          arena_high);
+    
+#undef COUNTER
+#undef GAUGE
+    
+    metrics_write_histogram(out, "minitel_write_latency", "Durée des appels write() sur le port série",
+                            &m->metrics.write_latency);
+    metrics_write_histogram(out, "minitel_pacing_error", "Retard du réveil sur l'échéance de cadencement",
+                            &m->metrics.pacing_error);
+    
+    if (fclose(out) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return rename(tmp_path, path);
+}
+
+/**
+ * @brief Port réel: writev()
+ */
+static ssize_t io_sys_writev(minitel_t *m, int fd, const struct iovec *iov, int iovcnt) {
+    (void)m;
+    return writev(fd, iov, iovcnt);
+}
+
+/**
+ * @brief Port réel: poll()
+ */
+static int io_sys_poll(minitel_t *m, struct pollfd *pfd, int timeout_ms) {
+    (void)m;
+    return poll(pfd, 1, timeout_ms);
+}
+
+static const port_io_t io_sys = { "système", io_sys_writev, io_sys_poll };
+
+/**
+ * @brief Tirage uniforme dans [0, 1000000) (splitmix64, sans verrou)
+ */
+static uint32_t faults_roll(port_faults_t *f) {
+    uint64_t z = atomic_fetch_add_explicit(&f->rng, 0x9E3779B97F4A7C15ULL, memory_order_relaxed)
+                 + 0x9E3779B97F4A7C15ULL;
+    
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (uint32_t)((z ^ (z >> 31)) % 1000000);
+}
+
+/**
+ * @brief Port avec fautes: EIO, EAGAIN, EINTR sans rien écrire, ou
+ *        écriture tronquée à un nombre d'octets tiré au hasard
+ */
+static ssize_t io_faults_writev(minitel_t *m, int fd, const struct iovec *iov, int iovcnt) {
+    port_faults_t *f = &m->engine->faults;
+    uint32_t roll = faults_roll(f);
+    struct iovec part[REPLAY_IOV_MAX];
+    size_t total = 0;
+    size_t keep;
+    int n = 0;
+    
+    if (roll < f->eio + f->eagain + f->eintr) {
+        metric_add(&m->metrics.faults_injected, 1);
+        errno = roll < f->eio ? EIO : roll < f->eio + f->eagain ? EAGAIN : EINTR;
+        return -1;
+    }
+    
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (roll >= f->eio + f->eagain + f->eintr + f->partial || total < 2 || iovcnt > REPLAY_IOV_MAX) {
+        return writev(fd, iov, iovcnt);
+    }
+    
+    keep = 1 + faults_roll(f) % (total - 1);
+    while (keep > 0) {
+        part[n] = iov[n];
+        if (part[n].iov_len > keep) {
+            part[n].iov_len = keep;
+        }
+        keep -= part[n].iov_len;
+        n++;
+    }
+    metric_add(&m->metrics.faults_injected, 1);
+    return writev(fd, part, n);
+}
+
+/**
+ * @brief Port avec fautes: port muet pendant stall_ms, puis poll() sur le reste du délai
+ */
+static int io_faults_poll(minitel_t *m, struct pollfd *pfd, int timeout_ms) {
+    port_faults_t *f = &m->engine->faults;
+    
+    if (f->stall > 0 && faults_roll(f) < f->stall) {
+        int ms = timeout_ms >= 0 && timeout_ms < f->stall_ms ? timeout_ms : f->stall_ms;
+        
+        metric_add(&m->metrics.faults_injected, 1);
+        usleep((useconds_t)ms * 1000);
+        if (timeout_ms >= 0) {
+            timeout_ms -= ms;
+            if (timeout_ms == 0) {
+                pfd->revents = 0;
+                return 0;
+            }
+        }
+    }
+    return poll(pfd, 1, timeout_ms);
+}
+
+static const port_io_t io_faults = { "fautes injectées", io_faults_writev, io_faults_poll };
+
+/**
+ * @brief Injecte des fautes dans les écritures sur le port principal (tests)
+ * 
+ * spec: "nom=pourcentage" séparés par des virgules, parmi eio (erreur
+ * fatale: le port est rouvert), eagain, eintr, partial (écriture
+ * tronquée) et stall (port muet pendant stall_ms, 100 par défaut);
+ * seed fixe le tirage. NULL ou "" rétablit le port réel. À appeler fil
+ * d'écriture au repos (avant output_init() ou entre deux passes). Les
+ * miroirs et l'écriture par io_uring (-U) ne sont pas touchés.
+ * @return 0, ou -1 si spec est invalide (rien n'est changé)
+ */
+int port_faults_set(minitel_t *m, const char *spec) {
+    struct minitel_engine *e = m->engine;
+    uint32_t rates[5] = { 0, 0, 0, 0, 0 };
+    static const char *const names[5] = { "eio", "eagain", "eintr", "partial", "stall" };
+    uint64_t seed = (uint64_t)time(NULL);
+    long stall_ms = 100;
+    uint64_t sum = 0;
+    char buf[256];
+    char msg[320];
+    char *save = NULL;
+    
+    if (spec == NULL || spec[0] == '\0') {
+        e->io = &io_sys;
+        return 0;
+    }
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    snprintf(buf, sizeof(buf), "%s", spec);
+    
+    for (char *item = strtok_r(buf, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        char *end;
+        int known = 0;
+        
+        if (value == NULL) {
+            return -1;
+        }
+        *value++ = '\0';
+        
+        if (strcmp(item, "seed") == 0) {
+            seed = strtoull(value, &end, 0);
+            known = 1;
+        } else if (strcmp(item, "stall_ms") == 0) {
+            stall_ms = strtol(value, &end, 10);
+            known = stall_ms >= 1 && stall_ms <= 60000;
+        } else {
+            double pct = strtod(value, &end);
+            for (int k = 0; k < 5; k++) {
+                if (strcmp(item, names[k]) == 0) {
+                    rates[k] = (uint32_t)(pct * 10000 + 0.5);
+                    known = pct >= 0 && pct <= 100;
+                }
+            }
+        }
+        if (!known || end == value || *end != '\0') {
+            return -1;
+        }
+    }
+    
+    // Un seul tirage choisit entre eio, eagain, eintr et partial
+    for (int k = 0; k < 4; k++) {
+        sum += rates[k];
+    }
+    if (sum > 1000000) {
+        return -1;
+    }
+    
+    e->faults.eio = rates[0];
+    e->faults.eagain = rates[1];
+    e->faults.eintr = rates[2];
+    e->faults.partial = rates[3];
+    e->faults.stall = rates[4];
+    e->faults.stall_ms = (int)stall_ms;
+    atomic_store(&e->faults.rng, seed);
+    e->io = &io_faults;
+    
+    snprintf(msg, sizeof(msg), "Port en mode %s: %s (graine %llu)", io_faults.name, spec, (unsigned long long)seed);
+    log_message("WARN", msg);
+    return 0;
+}
+
+/**
+ * @brief writev() sur le port, mesuré (durée, octets, erreurs)
+ */
+static ssize_t port_writev(minitel_t *m, int fd, const struct iovec *iov, int iovcnt) {
+    struct timespec before, after;
+    ssize_t written;
+    
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    written = m->engine->io->writev(m, fd, iov, iovcnt);
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    hist_record(&m->metrics.write_latency, (uint64_t)elapsed_us(&before, &after));
+    
+    if (written > 0) {
+        metric_add(&m->metrics.bytes_sent, (uint64_t)written);
+    } else if (written < 0 && errno != EAGAIN && errno != EINTR) {
+        metric_add(&m->metrics.write_errors, 1);
+    }
+    
+    return written;
+}
+
+/**
+ * @brief Ajoute un caractère UTF-8 à un tampon
+ */
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Point de code Unicode correspondant à une cellule de l'écran
+ */
+static uint32_t screen_cell_codepoint(const screen_cells_t *cells, int idx) {
+    uint8_t ch = cells->ch[idx];
+    
+    if (cells->attr[idx] & ATTR_G1) {
+        // Mosaïque 2x3 -> sextants Unicode (bloc "Symbols for Legacy Computing")
+        int v = (ch & 0x1F) | ((ch & 0x40) ? 0x20 : 0);
+        if (v == 0) return ' ';
+        if (v == 0x15) return 0x258C;
+        if (v == 0x2A) return 0x2590;
+        if (v == 0x3F) return 0x2588;
+        return 0x1FB00 + (uint32_t)(v - 1 - (v > 0x15) - (v > 0x2A));
+    }
+    
+    switch (cells->g2[idx]) {
+        case 0: return ch ? ch : ' ';  // cellule couverte par un double format
+        case 0x41: return ch == 'a' ? 0xE0 : ch == 'e' ? 0xE8 : ch == 'u' ? 0xF9 : ch;
+        case 0x42: return ch == 'e' ? 0xE9 : ch;
+        case 0x43: return ch == 'a' ? 0xE2 : ch == 'e' ? 0xEA : ch == 'i' ? 0xEE :
+                          ch == 'o' ? 0xF4 : ch == 'u' ? 0xFB : ch;
+        case 0x48: return ch == 'a' ? 0xE4 : ch == 'e' ? 0xEB : ch == 'i' ? 0xEF :
+                          ch == 'o' ? 0xF6 : ch == 'u' ? 0xFC : ch;
+        case 0x4B: return ch == 'c' ? 0xE7 : ch;
+        case 0x7A: return 0x153;
+        case 0x6A: return 0x152;
+        case 0x7B: return 0xDF;
+        case 0x23: return 0xA3;
+        case 0x27: return 0xA7;
+        case 0x30: return 0xB0;
+        case 0x31: return 0xB1;
+        default: return '?';
+    }
+}
+
+/**
+ * @brief Exporte le contenu de l'écran (rangées 1 à 24) en texte UTF-8
+ */
+int screen_dump(const minitel_screen_t *scr, const char *path) {
+    char tmp_path[512];
+    char line[SCREEN_COLS * 4 + 2];
+    FILE *out;
+    
+    // Écriture atomique: fichier temporaire puis renommage
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    
+    for (int r = 1; r <= SCREEN_ROWS; r++) {
+        size_t n = 0;
+        for (int c = 0; c < SCREEN_COLS; c++) {
+            n += utf8_encode(screen_cell_codepoint(&scr->cells, r * SCREEN_COLS + c), line + n);
+        }
+        line[n++] = '\n';
+        fwrite(line, 1, n, out);
+    }
+    
+    fclose(out);
+    return rename(tmp_path, path);
+}
+
+/**
+ * @brief Exporte l'écran si SIGUSR1 a été reçu
+ */
+void screen_dump_if_requested(minitel_t *m) {
+    char msg[300];
+    
+    if (!m->dump) {
+        return;
+    }
+    m->dump = 0;
+    
+    if (screen_dump(&m->screen, SCREEN_DUMP_FILE) == 0) {
+        snprintf(msg, sizeof(msg), "Capture d'écran écrite dans %s", SCREEN_DUMP_FILE);
+        log_message("INFO", msg);
+    } else {
+        log_message("WARN", "Impossible d'écrire la capture d'écran");
+    }
+}
+
+/**
+ * @brief Nom lisible d'une touche de fonction
+ */
+const char *key_name(int key) {
+    switch (key) {
+        case KEY_ENVOI: return "ENVOI";
+        case KEY_RETOUR: return "RETOUR";
+        case KEY_REPETITION: return "REPETITION";
+        case KEY_GUIDE: return "GUIDE";
+        case KEY_ANNULATION: return "ANNULATION";
+        case KEY_SOMMAIRE: return "SOMMAIRE";
+        case KEY_CORRECTION: return "CORRECTION";
+        case KEY_SUITE: return "SUITE";
+        case KEY_CONNEXION_FIN: return "CONNEXION/FIN";
+        default: return "?";
+    }
+}
+
+/**
+ * @brief Décode un octet reçu du clavier du Minitel
+ * 
+ * Les touches de fonction arrivent sous la forme SEP (0x13) + code,
+ * les autres touches comme caractères. Les événements sont rangés dans
+ * une petite file circulaire (les plus anciens sont perdus si elle déborde).
+ */
+void keyboard_feed(minitel_t *m, uint8_t b) {
+    struct minitel_engine *e = m->engine;
+    int event = -1;
+    
+    b &= 0x7F;
+    
+    if (e->keyboard_state == 0x13) {
+        e->keyboard_state = 0;
+        if (b >= 0x41 && b <= 0x49) {
+            event = KEY_FUNCTION | b;
+        }
+    } else if (e->keyboard_state == 0x1B) {
+        e->keyboard_state = 0;  // séquence ESC (flèches...): ignorée
+    } else if (b == 0x13 || b == 0x1B) {
+        e->keyboard_state = b;
+    } else if (b >= 0x20 && b < 0x7F) {
+        event = b;
+    }
+    
+    if (event >= 0) {
+        e->key_queue[e->key_head % KEY_QUEUE_SIZE] = event;
+        e->key_head++;
+        if (e->key_head - e->key_tail > KEY_QUEUE_SIZE) {
+            e->key_tail = e->key_head - KEY_QUEUE_SIZE;
+        }
+    }
+}
+
+/**
+ * @brief Retire le prochain événement clavier
+ * @return Touche (caractère ou KEY_*), -1 si la file est vide
+ */
+int key_pop(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    
+    if (e->key_tail == e->key_head) {
+        return -1;
+    }
+    return e->key_queue[e->key_tail++ % KEY_QUEUE_SIZE];
+}
+
+/**
+ * @brief Vide la file des événements clavier
+ */
+void key_flush(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    
+    e->key_tail = e->key_head;
+    e->keyboard_state = 0;
+}
+
+/**
+ * @brief Octets encore dans l'anneau de sortie
+ */
+static size_t output_pending(const struct minitel_engine *e) {
+    return atomic_load_explicit(&e->output_ring.head, memory_order_acquire) -
+           atomic_load_explicit(&e->output_ring.tail, memory_order_acquire);
+}
+
+/**
+ * @brief Le fil d'écriture a-t-il de quoi écrire sans avancer ?
+ */
+static int output_stalled(struct minitel_engine *e) {
+    struct timespec now;
+    
+    if (!e->writer_started || atomic_load(&e->writer_idle) ||
+        (output_pending(e) == 0 && atomic_load(&e->replay) == NULL)) {
+        return 0;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    return now_us - atomic_load(&e->writer_progress_us) > OUTPUT_STALL_US + atomic_load(&e->output_delay);
+}
+
+/**
+ * @brief Envoie un état à systemd (protocole sd_notify, sans libsystemd)
+ * 
+ * Sans NOTIFY_SOCKET (lancement hors systemd), ne fait rien.
+ * @return 1 si envoyé, 0 si pas de gestionnaire, -1 en cas d'erreur
+ */
+int sd_notify_send(const char *state) {
+    const char *path = getenv("NOTIFY_SOCKET");
+    struct sockaddr_un addr;
+    size_t path_len;
+    
+    if (path == NULL || (path[0] != '/' && path[0] != '@')) {
+        return 0;
+    }
+    
+    path_len = strlen(path);
+    if (path_len >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    
+    if (notify_fd < 0) {
+        notify_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (notify_fd < 0) {
+            return -1;
+        }
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, path_len);
+    if (addr.sun_path[0] == '@') {
+        addr.sun_path[0] = '\0';  // socket abstraite
+    }
+    
+    if (sendto(notify_fd, state, strlen(state), MSG_NOSIGNAL, (struct sockaddr *)&addr,
+               (socklen_t)(offsetof(struct sockaddr_un, sun_path) + path_len)) < 0) {
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Met à jour la ligne d'état affichée par systemctl status
+ */
+void sd_status(const char *format, ...) {
+    char state[192];
+    va_list args;
+    
+    memcpy(state, "STATUS=", 7);
+    va_start(args, format);
+    vsnprintf(state + 7, sizeof(state) - 7, format, args);
+    va_end(args);
+    sd_notify_send(state);
+}
+
+/**
+ * @brief Signe de vie: ping du watchdog systemd, ou ligne de log hors systemd
+ * 
+ * Appelé par la minuterie du watchdog, donc seulement quand la boucle
+ * d'événements tourne. Une ligne bloquée ne bloque plus la boucle (port
+ * non bloquant): le fil d'écriture qui ne progresse plus fait rouvrir le
+ * port, et les signes de vie continuent.
+ */
+void watchdog_kick(minitel_t *m) {
+    if (output_stalled(m->engine) && !m->reconnect) {
+        log_message("ERROR", "Watchdog: écriture série bloquée, reconnexion");
+        m->reconnect = 1;
+    }
+    if (watchdog_usec > 0) {
+        sd_notify_send("WATCHDOG=1");
+    } else {
+        log_message("INFO", "Watchdog: système vivant");
+    }
+}
+
+/**
+ * @brief Période du watchdog systemd (WATCHDOG_USEC), 0 hors systemd
+ */
+long sd_watchdog_usec(void) {
+    return watchdog_usec;
+}
+
+/**
+ * @brief (Ré)arme la minuterie du watchdog
+ * 
+ * Sous systemd, le ping part à la moitié de WatchdogSec; sinon un signe
+ * de vie est journalisé toutes les watchdog_timeout secondes.
+ */
+int watchdog_arm(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    struct itimerspec its;
+    long period_usec = watchdog_usec > 0 ? watchdog_usec / 2 : m->watchdog_timeout * 1000000L;
+    
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec = period_usec / 1000000;
+    its.it_interval.tv_nsec = (period_usec % 1000000) * 1000;
+    its.it_value = its.it_interval;
+    return timerfd_settime(e->watchdog_timer_fd, 0, &its, NULL);
+}
+
+/**
+ * @brief Lit WATCHDOG_USEC et crée la minuterie du watchdog
+ */
+static int watchdog_init(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    const char *usec = getenv("WATCHDOG_USEC");
+    const char *pid = getenv("WATCHDOG_PID");
+    
+    if (usec != NULL && (pid == NULL || atol(pid) == (long)getpid())) {
+        watchdog_usec = atol(usec);
+    }
+    
+    e->watchdog_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (e->watchdog_timer_fd < 0) {
+        return -1;
+    }
+    return watchdog_arm(m);
+}
+
+/**
+ * @brief Instant du lancement du processus, sur l'horloge CLOCK_MONOTONIC
+ * 
+ * D'après /proc/self/stat (starttime, en tops d'horloge depuis le
+ * démarrage du système): le chargement du programme et ce qui précède
+ * minitel_init() comptent aussi. À défaut, l'instant présent.
+ */
+static void process_start(struct timespec *start) {
+    FILE *stat_file = fopen("/proc/self/stat", "r");
+    unsigned long long ticks;
+    struct timespec boot;
+    char buf[1024];
+    size_t n = 0;
+    char *fields;
+    
+    clock_gettime(CLOCK_MONOTONIC, start);
+    if (stat_file != NULL) {
+        n = fread(buf, 1, sizeof(buf) - 1, stat_file);
+        fclose(stat_file);
+    }
+    buf[n] = '\0';
+    
+    // Le nom (champ 2) peut contenir des espaces: on repart de la dernière ')'
+    fields = strrchr(buf, ')');
+    if (fields == NULL || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u"
+                                 " %*d %*d %*d %*d %*d %*d %llu", &ticks) != 1) {
+        return;
+    }
+    
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    int64_t age_us = (int64_t)boot.tv_sec * 1000000 + boot.tv_nsec / 1000 -
+                     (int64_t)(ticks * 1000000ULL / (unsigned long long)sysconf(_SC_CLK_TCK));
+    if (age_us > 0 && age_us < 3600LL * 1000000) {
+        int64_t us = (int64_t)start->tv_sec * 1000000 + start->tv_nsec / 1000 - age_us;
+        start->tv_sec = us / 1000000;
+        start->tv_nsec = (us % 1000000) * 1000;
+    }
+}
+
+/**
+ * @brief Prépare un contexte: réglages par défaut, modèle d'écran vide et
+ *        boucle d'événements (epoll + minuteries de cadencement, du
+ *        watchdog et de l'export des métriques)
+ * 
+ * Le fil d'écriture n'est lancé que par output_init().
+ * @return 0 si OK, -1 en cas d'erreur (minitel_close() libère le reste)
+ */
+int minitel_init(minitel_t *m) {
+    struct minitel_engine *e;
+    struct epoll_event ev;
+    struct itimerspec its;
+    
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+    m->running = 1;
+    m->chars_per_line = CHARS_PER_LINE;
+    m->lines_skip = LINES_SKIP;
+    m->watchdog_timeout = WATCHDOG_TIMEOUT;
+    m->rt_policy = SCHED_FIFO;
+    m->rt_cpu = -1;
+    snprintf(m->metrics_file, sizeof(m->metrics_file), "%s", METRICS_FILE);
+    m->terminal.model = "inconnu";
+    m->terminal.speed = DEFAULT_SPEED;
+    m->terminal.max_speed = DEFAULT_SPEED;
+    screen_reset(&m->screen);
+    
+    e = aligned_alloc(_Alignof(struct minitel_engine), sizeof(struct minitel_engine));
+    if (e == NULL) {
+        log_message("ERROR", "Allocation du contexte impossible");
+        return -1;
+    }
+    memset(e, 0, sizeof(*e));
+    m->engine = e;
+    e->epoll_fd = e->pace_timer_fd = e->serial_event_fd = -1;
+    e->watchdog_timer_fd = e->metrics_timer_fd = -1;
+    e->writer_wake_fd = e->output_wake_fd = -1;
+    e->prepared[0].page = e->prepared[1].page = -1;
+    atomic_init(&e->output_fd, -1);
+    for (int k = 0; k < OUTPUT_MAX_MIRRORS; k++) {
+        atomic_init(&e->output_mirrors[k], -1);
+        e->mirror_fds[k] = -1;
+    }
+    atomic_init(&e->writer_idle, 1);
+    e->io = &io_sys;
+    process_start(&e->started);
+#ifdef HAVE_IO_URING
+    e->uring.fd = -1;
+#endif
+    
+    e->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    e->pace_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    e->metrics_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (e->epoll_fd < 0 || e->pace_timer_fd < 0 || e->metrics_timer_fd < 0 || watchdog_init(m) < 0) {
+        log_message("ERROR", "Création de la boucle d'événements impossible");
+        return -1;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = e->pace_timer_fd;
+    if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, e->pace_timer_fd, &ev) < 0) {
+        return -1;
+    }
+    
+    ev.data.fd = e->watchdog_timer_fd;
+    if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, e->watchdog_timer_fd, &ev) < 0) {
+        return -1;
+    }
+    
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec = METRICS_INTERVAL;
+    its.it_value.tv_sec = METRICS_INTERVAL;
+    timerfd_settime(e->metrics_timer_fd, 0, &its, NULL);
+    ev.data.fd = e->metrics_timer_fd;
+    return epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, e->metrics_timer_fd, &ev);
+}
+
+/**
+ * @brief Fait servir un descripteur de l'appelant par la boucle d'événements
+ * 
+ * handler est appelé depuis event_wait_until() quand fd est lisible; il
+ * peut lever m->interrupt pour écourter la passe en cours.
+ * @return 0 si OK, -1 si la table est pleine ou epoll refuse fd
+ */
+int event_loop_watch(minitel_t *m, int fd, event_handler_t handler) {
+    struct minitel_engine *e = m->engine;
+    struct epoll_event ev;
+    
+    if (e->nwatches >= EVENT_MAX_WATCHES) {
+        return -1;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        return -1;
+    }
+    
+    e->watches[e->nwatches].fd = fd;
+    e->watches[e->nwatches].handler = handler;
+    e->nwatches++;
+    return 0;
+}
+
+/**
+ * @brief Ajoute (fd >= 0) ou retire (fd < 0) le port série de la boucle
+ */
+void event_loop_set_serial(minitel_t *m, int fd) {
+    struct minitel_engine *e = m->engine;
+    struct epoll_event ev;
+    
+    if (e->serial_event_fd >= 0) {
+        epoll_ctl(e->epoll_fd, EPOLL_CTL_DEL, e->serial_event_fd, NULL);
+        e->serial_event_fd = -1;
+    }
+    
+    if (fd >= 0) {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+            e->serial_event_fd = fd;
+        }
+    }
+    
+    key_flush(m);
+}
+
+/**
+ * @brief Lit ce que le Minitel a envoyé et le décode
+ */
+static void serial_receive(minitel_t *m, int fd) {
+    uint8_t buf[64];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    
+    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        log_message("ERROR", "Erreur lecture port série");
+        m->reconnect = 1;
+        return;
+    }
+    
+    for (ssize_t i = 0; i < n; i++) {
+        keyboard_feed(m, buf[i]);
+    }
+}
+
+/**
+ * @brief Avance un instant de usec microsecondes
+ */
+static inline void timespec_add_us(struct timespec *ts, long usec) {
+    ts->tv_sec += usec / 1000000;
+    ts->tv_nsec += (usec % 1000000) * 1000;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief Traite les événements jusqu'à l'échéance (absolue, CLOCK_MONOTONIC)
+ * 
+ * Remplace usleep(): pendant l'attente, le clavier du Minitel est lu et
+ * les demandes de capture d'écran sont servies.
+ * @param wake_on_key Rendre la main dès qu'une touche est disponible
+ * @return 1 si une touche est en attente, 0 à l'échéance, -1 si arrêt
+ */
+int event_wait_until(minitel_t *m, const struct timespec *deadline, int wake_on_key) {
+    struct minitel_engine *e = m->engine;
+    struct itimerspec its;
+    struct epoll_event events[4];
+    
+    memset(&its, 0, sizeof(its));
+    its.it_value = *deadline;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+        its.it_value.tv_nsec = 1;  // 0 désarmerait la minuterie
+    }
+    timerfd_settime(e->pace_timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    
+    while (m->running && !m->reconnect) {
+        int n = epoll_wait(e->epoll_fd, events, 4, -1);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                screen_dump_if_requested(m);
+                continue;
+            }
+            return -1;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            event_watch_t *watch = NULL;
+            
+            for (int w = 0; w < e->nwatches; w++) {
+                if (events[i].data.fd == e->watches[w].fd) {
+                    watch = &e->watches[w];
+                }
+            }
+            
+            if (watch != NULL) {
+                watch->handler(m, watch->fd);
+            } else if (events[i].data.fd == e->pace_timer_fd) {
+                uint64_t expirations;
+                if (read(e->pace_timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    return e->key_head != e->key_tail;
+                }
+            } else if (events[i].data.fd == e->watchdog_timer_fd) {
+                uint64_t expirations;
+                if (read(e->watchdog_timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    watchdog_kick(m);
+                }
+            } else if (events[i].data.fd == e->output_wake_fd) {
+                // Le fil d'écriture a avancé: l'encodeur qui l'attend reprend la main
+                uint64_t wakeups;
+                if (read(e->output_wake_fd, &wakeups, sizeof(wakeups)) > 0 && atomic_load(&e->output_waiting)) {
+                    return e->key_head != e->key_tail;
+                }
+            } else if (events[i].data.fd == e->metrics_timer_fd) {
+                uint64_t expirations;
+                if (read(e->metrics_timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    metrics_export(m);
+                }
+            } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                log_message("ERROR", "Port série déconnecté");
+                m->reconnect = 1;
+            } else {
+                serial_receive(m, events[i].data.fd);
+            }
+        }
+        
+        if (wake_on_key && e->key_head != e->key_tail) {
+            return 1;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Attend usec microsecondes en traitant les événements
+ */
+int event_wait(minitel_t *m, long usec, int wake_on_key) {
+    struct timespec deadline;
+    
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    timespec_add_us(&deadline, usec);
+    return event_wait_until(m, &deadline, wake_on_key);
+}
+
+/**
+ * @brief Démarre une rafale cadencée à delay µs par créneau
+ */
+void pacer_start(pacer_t *pacer, metrics_t *metrics, long delay) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->metrics = metrics;
+    pacer->delay = delay;
+    pacer->bytes = atomic_load_explicit(&metrics->bytes_sent, memory_order_relaxed);
+    clock_gettime(CLOCK_MONOTONIC, &pacer->start);
+    pacer->slot = pacer->start;
+}
+
+/**
+ * @brief Passe au créneau suivant (pacer->slot devient la prochaine échéance)
+ * 
+ * Les échéances sont absolues: le temps passé dans write() et le retard
+ * de réveil ne s'ajoutent plus au délai, le rythme moyen reste celui
+ * demandé. Un octet parti après son créneau compte comme dépassement;
+ * au-delà de PACE_MAX_LAG créneaux de retard, l'horloge est recalée
+ * plutôt que de rattraper d'un coup.
+ */
+void pacer_next(pacer_t *pacer) {
+    struct timespec now;
+    
+    pacer->slots++;
+    if (pacer->delay <= 0) {
+        return;
+    }
+    
+    timespec_add_us(&pacer->slot, pacer->delay);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    int64_t late = elapsed_us(&pacer->slot, &now);
+    if (late > 0) {
+        pacer->overruns++;
+        metric_add(&pacer->metrics->pacing_overruns, 1);
+        if (late > PACE_MAX_LAG * pacer->delay) {
+            pacer->slot = now;
+            pacer->resyncs++;
+        }
+    }
+}
+
+/**
+ * @brief Attend le créneau suivant en servant la boucle d'événements
+ */
+int pacer_wait(minitel_t *m, pacer_t *pacer, int wake_on_key) {
+    pacer_next(pacer);
+    if (pacer->delay <= 0) {
+        return event_wait(m, 0, wake_on_key);  // sert quand même clavier et watchdog
+    }
+    
+    // Octets cadencés par l'appelant, pas par le fil d'écriture: retard mesuré ici
+    int r = event_wait_until(m, &pacer->slot, wake_on_key);
+    if (r >= 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t late = elapsed_us(&pacer->slot, &now);
+        if (late >= 0) {  // sinon réveillé par une touche avant l'échéance
+            hist_record(&m->metrics.pacing_error, (uint64_t)late);
+        }
+    }
+    return r;
+}
+
+/**
+ * @brief Clôt une rafale: heure de fin et nombre d'octets émis
+ */
+void pacer_stop(pacer_t *pacer) {
+    clock_gettime(CLOCK_MONOTONIC, &pacer->end);
+    pacer->bytes = atomic_load_explicit(&pacer->metrics->bytes_sent, memory_order_relaxed) - pacer->bytes;
+}
+
+/**
+ * @brief Bilan d'une rafale close: débit réel, dérive et dépassements
+ * 
+ * Met à jour les jauges de cadencement; journalise le bilan si what
+ * n'est pas NULL.
+ */
+void pacer_report(const pacer_t *pacer, const char *what) {
+    char msg[256];
+    
+    if (pacer->delay <= 0 || pacer->slots == 0) {
+        return;
+    }
+    
+    int64_t elapsed = elapsed_us(&pacer->start, &pacer->end);
+    uint64_t bytes = pacer->bytes;
+    double drift = (double)elapsed / ((double)pacer->slots * pacer->delay) - 1.0;
+    double rate = elapsed > 0 ? (double)bytes * 1e6 / (double)elapsed : 0.0;
+    
+    metric_set(&pacer->metrics->pacing_target_rate, 1000000 / pacer->delay);
+    metric_set(&pacer->metrics->pacing_actual_rate, (int64_t)rate);
+    metric_set(&pacer->metrics->pacing_drift_ppm, (int64_t)(drift * 1e6));
+    
+    if (what != NULL) {
+        snprintf(msg, sizeof(msg),
+                 "Cadencement %s: %ld µs visés, %.0f µs réels (dérive %+.1f %%), %.0f octets/s, %lu dépassement(s), %lu recalage(s)",
+                 what, pacer->delay, (double)elapsed / (double)pacer->slots, drift * 100.0, rate,
+                 pacer->overruns, pacer->resyncs);
+        log_message("INFO", msg);
+    }
+}
+
+/**
+ * @brief Clôt une rafale et en fait le bilan
+ */
+void pacer_finish(pacer_t *pacer, const char *what) {
+    pacer_stop(pacer);
+    pacer_report(pacer, what);
+}
+
+/**
+ * @brief Réveille la boucle d'événements si l'encodeur attend le fil d'écriture
+ */
+static void output_notify(struct minitel_engine *e) {
+    uint64_t one = 1;
+    
+    if (atomic_load(&e->output_waiting) && write(e->output_wake_fd, &one, sizeof(one)) < 0) {
+        // compteur eventfd saturé: un réveil est déjà en attente
+    }
+}
+
+/**
+ * @brief Dort jusqu'au créneau (échéance absolue) et mesure le retard du réveil
+ * 
+ * Seule mesure de minitel_pacing_error: c'est ce fil qui cadence les
+ * octets. hist_record() est sans verrou, donc sûr ici.
+ */
+static void writer_sleep_until(minitel_t *m, const struct timespec *at) {
+    struct timespec now;
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, at, NULL) == EINTR) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    int64_t late = elapsed_us(at, &now);
+    hist_record(&m->metrics.pacing_error, late > 0 ? (uint64_t)late : 0);
+}
+
+/**
+ * @brief Écrit des morceaux de tampons en attendant que le port les accepte
+ * 
+ * Ne bloque jamais plus de timeout_ms d'affilée sans revérifier l'arrêt
+ * et l'abandon de la file: un port bloqué ne fige pas le fil d'écriture.
+ * Une écriture partielle reprend au premier octet non écrit, EAGAIN et
+ * EINTR font attendre le port de nouveau; iov n'est pas modifié (il sert
+ * encore aux miroirs). Le port principal passe par e->io (fautes
+ * injectées possibles), les miroirs par les appels système.
+ * @param retry Réessayer tant que le port n'accepte pas (port principal);
+ *        sinon abandonner au premier délai dépassé (miroir)
+ * @return 0 si tout est écrit, -1 si erreur, abandon ou délai dépassé
+ */
+static int writer_putv(minitel_t *m, int fd, const struct iovec *iov, int iovcnt, int timeout_ms, int retry) {
+    struct minitel_engine *e = m->engine;
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    struct iovec left[REPLAY_IOV_MAX];
+    int main_port = fd == atomic_load(&e->output_fd);
+    int first = 0;
+    
+    memcpy(left, iov, (size_t)iovcnt * sizeof(*iov));
+    while (!atomic_load(&e->writer_stop) && !atomic_load(&e->output_discard) && !atomic_load(&e->replay_stop)) {
+        int r = main_port ? e->io->poll(m, &pfd, timeout_ms) : poll(&pfd, 1, timeout_ms);
+        
+        if (r < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (r == 0 && !retry) {
+            return -1;
+        }
+        if (r <= 0) {
+            continue;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            return -1;
+        }
+        
+        ssize_t n = main_port ? port_writev(m, fd, left + first, iovcnt - first)
+                              : writev(fd, left + first, iovcnt - first);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return -1;
+        }
+        
+        // Les morceaux vides sont passés aussi: writev() n'en dirait rien
+        while (first < iovcnt && (n > 0 || left[first].iov_len == 0)) {
+            size_t part = (size_t)n < left[first].iov_len ? (size_t)n : left[first].iov_len;
+            left[first].iov_base = (uint8_t *)left[first].iov_base + part;
+            left[first].iov_len -= part;
+            n -= (ssize_t)part;
+            if (left[first].iov_len == 0) {
+                first++;
+            }
+        }
+        if (first == iovcnt) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Retire un port miroir qui n'accepte plus les octets
+ * 
+ * Le descripteur reste ouvert (il appartient au fil principal, qui le
+ * ferme à la déconnexion): le fil d'écriture cesse seulement d'y écrire.
+ */
+static void mirror_drop(struct minitel_engine *e, int index, const char *why) {
+    char msg[128];
+    
+    atomic_store(&e->output_mirrors[index], -1);
+    snprintf(msg, sizeof(msg), "Miroir %d retiré: %s", index + 1, why);
+    log_message("WARN", msg);
+}
+
+/**
+ * @brief Port principal perdu: la file est abandonnée, la boucle reconnecte
+ */
+static void writer_lost(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    
+    if (!atomic_load(&e->writer_stop) && !atomic_load(&e->output_discard)) {
+        m->reconnect = 1;
+    }
+    atomic_store(&e->output_discard, 1);
+}
+
+/**
+ * @brief Écrit ce que le port accepte des octets en tête de l'anneau
+ * 
+ * Le port est non bloquant: on attend POLLOUT (OUTPUT_POLL_MS au plus,
+ * puis writer_main() revérifie l'arrêt), et un seul writev() prend
+ * jusqu'à OUTPUT_BATCH octets, dont au plus un cadencé si un délai court
+ * (les octets non cadencés qui le précèdent partent dans son créneau).
+ * Ce que le pilote ne prend pas reste dans l'anneau pour le tour suivant.
+ * Les miroirs reçoivent exactement les octets écrits.
+ * @param paced Octets cadencés parmi ceux écrits
+ * @return Octets écrits, à retirer de l'anneau
+ */
+static size_t writer_step_poll(minitel_t *m, size_t tail, size_t head, long delay, size_t *paced) {
+    struct minitel_engine *e = m->engine;
+    int fd = atomic_load(&e->output_fd);
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    uint8_t bytes[OUTPUT_BATCH];
+    uint16_t flags[OUTPUT_BATCH];
+    struct iovec iov = { .iov_base = bytes, .iov_len = 0 };
+    ssize_t n;
+    int r;
+    
+    *paced = 0;
+    while (tail + iov.iov_len < head && iov.iov_len < OUTPUT_BATCH) {
+        uint16_t slot = e->output_ring.slots[(tail + iov.iov_len) & (OUTPUT_RING_SIZE - 1)];
+        
+        bytes[iov.iov_len] = (uint8_t)slot;
+        flags[iov.iov_len++] = slot & OUTPUT_PACED;
+        if ((slot & OUTPUT_PACED) && delay > 0) {
+            break;  // un seul créneau par écriture
+        }
+    }
+    
+    r = e->io->poll(m, &pfd, OUTPUT_POLL_MS);
+    if ((r < 0 && errno != EINTR) || (r > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))) {
+        writer_lost(m);
+        return 0;
+    }
+    if (r <= 0) {
+        return 0;  // port muet: writer_main() revérifie l'arrêt et l'abandon
+    }
+    
+    n = port_writev(m, fd, &iov, 1);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            writer_lost(m);
+        }
+        return 0;
+    }
+    
+    iov.iov_len = (size_t)n;
+    for (int k = 0; k < OUTPUT_MAX_MIRRORS && n > 0; k++) {
+        int mirror = atomic_load(&e->output_mirrors[k]);
+        if (mirror >= 0 && writer_putv(m, mirror, &iov, 1, OUTPUT_MIRROR_MS, 0) < 0) {
+            mirror_drop(e, k, "port bloqué ou en erreur");
+        }
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        *paced += flags[i] != 0;
+    }
+    return (size_t)n;
+}
+
+/**
+ * @brief Rejoue un passage pré-encodé par writev(), sans copie
+ * 
+ * Avec cadencement, chaque écriture porte un octet cadencé et les
+ * segments non cadencés qui le suivent (retour à la ligne): le saut de
+ * ligne ne coûte pas d'appel système. Sans délai, une écriture prend
+ * jusqu'à REPLAY_IOV_MAX segments. Toujours par writev(), même avec
+ * io_uring (-U), qui ne sert qu'à l'anneau.
+ */
+static void writer_replay(minitel_t *m, const output_segment_t *segs, int count, pacer_t *pacer) {
+    struct minitel_engine *e = m->engine;
+    struct iovec iov[REPLAY_IOV_MAX];
+    replay_cursor_t at = { 0, 0, 0 };
+    struct timespec next_at = { 0, 0 };
+    struct timespec now;
+    int waiting = 0;
+    
+    while (at.seg < count && !atomic_load(&e->writer_stop) && !atomic_load(&e->output_discard) &&
+           !atomic_load(&e->replay_stop)) {
+        replay_cursor_t to = at;
+        uint64_t paced = 0;
+        int niov = 0;
+        
+        while (to.seg < count && niov < REPLAY_IOV_MAX) {
+            const output_segment_t *seg = &segs[to.seg];
+            uint32_t take = seg->len - to.off;
+            
+            if (seg->flags & SEGMENT_PACED) {
+                if (pacer->delay > 0 && paced > 0) {
+                    break;  // un seul créneau par écriture
+                }
+                if (pacer->delay > 0) {
+                    take = 1;
+                }
+                paced += take;
+            }
+            iov[niov].iov_base = (void *)(seg->base + to.off);
+            iov[niov].iov_len = take;
+            niov++;
+            to.off += take;
+            to.bytes += take;
+            if (to.off < seg->len) {
+                break;
+            }
+            to.seg++;
+            to.off = 0;
+        }
+        
+        if (waiting) {
+            writer_sleep_until(m, &next_at);
+            waiting = 0;
+        }
+        
+        if (writer_putv(m, atomic_load(&e->output_fd), iov, niov, OUTPUT_POLL_MS, 1) < 0) {
+            if (!atomic_load(&e->replay_stop)) {
+                writer_lost(m);  // sinon passage arrêté pendant que le port était bloqué
+            }
+            break;
+        }
+        for (int k = 0; k < OUTPUT_MAX_MIRRORS; k++) {
+            int fd = atomic_load(&e->output_mirrors[k]);
+            if (fd >= 0 && writer_putv(m, fd, iov, niov, OUTPUT_MIRROR_MS, 0) < 0 && !atomic_load(&e->replay_stop)) {
+                mirror_drop(e, k, "port bloqué ou en erreur");
+            }
+        }
+        
+        at = to;
+        atomic_store(&e->replay_done, at.bytes);
+        if (pacer->delay <= 0) {
+            pacer->slots += paced;
+        } else if (paced > 0) {
+            pacer_next(pacer);
+            next_at = pacer->slot;
+            waiting = 1;
+        }
+        
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        atomic_store(&e->writer_progress_us, (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+    }
+}
+
+#ifdef HAVE_IO_URING
+/**
+ * @brief Crée l'instance io_uring et projette ses anneaux
+ * 
+ * Le travail différé du noyau ne s'exécute que dans io_uring_enter()
+ * (DEFER_TASKRUN): sinon sa notification, vue comme un signal en attente,
+ * interrompt les écritures tty (-EINTR). L'instance naît désactivée et
+ * le fil d'écriture l'active, ce qui en fait son unique émetteur.
+ * @return 0, ou -1 (errno) si le noyau la refuse (noyau antérieur à 6.1,
+ *         seccomp, kernel.io_uring_disabled)
+ */
+static int uring_init(uring_t *uring, unsigned entries) {
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    uint8_t *sq, *cq;
+    
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED;
+    uring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (uring->fd < 0) {
+        return -1;
+    }
+    
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+    }
+    
+    sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    cq = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq :
+         mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+    uring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || uring->sqes == MAP_FAILED) {
+        close(uring->fd);
+        uring->fd = -1;
+        errno = ENOMEM;
+        return -1;
+    }
+    
+    uring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    uring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    uring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    uring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    uring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    uring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * @brief Abandonne io_uring: la suite passe par l'écriture classique
+ */
+static void uring_fallback(uring_t *uring, const char *why) {
+    char msg[160];
+    
+    snprintf(msg, sizeof(msg), "io_uring abandonné (%s), retour à l'écriture classique", why);
+    log_message("ERROR", msg);
+    close(uring->fd);
+    uring->fd = -1;
+}
+
+/**
+ * @brief Prépare une SQE (remise à zéro) à la suite de la file de soumission
+ */
+static struct io_uring_sqe *uring_sqe(uring_t *uring, uint8_t opcode, int fd, uint8_t flags, uint64_t user_data) {
+    unsigned tail = *uring->sq_tail + uring->queued;
+    unsigned index = tail & *uring->sq_mask;
+    struct io_uring_sqe *sqe = &uring->sqes[index];
+    
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->flags = flags;
+    sqe->user_data = user_data;
+    uring->sq_array[index] = index;
+    uring->queued++;
+    return sqe;
+}
+
+/**
+ * @brief Soumet les SQE préparées et attend wait complétions
+ */
+static int uring_submit_wait(uring_t *uring, unsigned wait) {
+    unsigned submit = uring->queued;
+    
+    atomic_store_explicit((_Atomic unsigned *)uring->sq_tail, *uring->sq_tail + submit, memory_order_release);
+    uring->queued = 0;
+    
+    while (syscall(__NR_io_uring_enter, uring->fd, submit, wait, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+        submit = 0;  // déjà consommées par le noyau
+    }
+    return 0;
+}
+
+/**
+ * @brief Rafale d'octets confiée au noyau, cadencée par des délais liés
+ * 
+ * Pour chaque port, une chaîne: TIMEOUT (échéance absolue du créneau,
+ * si l'octet précédent en occupait un) -> WRITE -> LINK_TIMEOUT, reliées
+ * par IOSQE_IO_HARDLINK (l'expiration d'un TIMEOUT rend -ETIME, ce qui
+ * romprait un lien simple). Le LINK_TIMEOUT annule une écriture bloquée.
+ * Les chaînes de tous les ports partent dans le même io_uring_enter():
+ * un réveil par rafale de URING_BATCH octets au lieu d'un par caractère,
+ * et les ports restent en phase puisque les échéances sont absolues.
+ * @return nombre d'éléments de l'anneau consommés
+ */
+static size_t writer_step_uring(minitel_t *m, size_t tail, size_t head, pacer_t *pacer, struct timespec *next_at,
+                                int *waiting) {
+    struct minitel_engine *e = m->engine;
+    uring_t *uring = &e->uring;
+    int fds[1 + OUTPUT_MAX_MIRRORS];
+    int has_slot[URING_BATCH];
+    size_t done[1 + OUTPUT_MAX_MIRRORS] = { 0 };
+    size_t count = head - tail;
+    int nfds = 0;
+    int stalled = 0;
+    
+    if (count > URING_BATCH) {
+        count = URING_BATCH;
+    }
+    
+    uring->write_limit.tv_nsec = OUTPUT_POLL_MS * 1000000LL;
+    uring->write_limit.tv_sec = uring->write_limit.tv_nsec / 1000000000LL;
+    uring->write_limit.tv_nsec %= 1000000000LL;
+    uring->mirror_limit.tv_nsec = OUTPUT_MIRROR_MS * 1000000LL;
+    
+    // Échéances: l'octet k attend le créneau ouvert par le dernier octet cadencé
+    for (size_t k = 0; k < count; k++) {
+        uint16_t slot = e->output_ring.slots[(tail + k) & (OUTPUT_RING_SIZE - 1)];
+        
+        uring->bytes[k] = (uint8_t)slot;
+        has_slot[k] = *waiting;
+        uring->slots[k].tv_sec = next_at->tv_sec;
+        uring->slots[k].tv_nsec = next_at->tv_nsec;
+        *waiting = 0;
+        
+        if (slot & OUTPUT_PACED) {
+            pacer_next(pacer);
+            *next_at = pacer->slot;
+            *waiting = pacer->delay > 0;
+        }
+    }
+    
+    fds[nfds++] = atomic_load(&e->output_fd);
+    for (int k = 0; k < OUTPUT_MAX_MIRRORS; k++) {
+        fds[nfds++] = atomic_load(&e->output_mirrors[k]);
+    }
+    
+    // Une chaîne rompue reprend à son premier octet non écrit: les écritures
+    // tty passent par les threads io-wq, que le noyau interrompt parfois (-EINTR)
+    while (!atomic_load(&e->writer_stop) && !atomic_load(&e->output_discard)) {
+        unsigned expected = 0;
+        size_t before = done[0];
+        
+        for (int p = 0; p < nfds; p++) {
+            if (fds[p] < 0) {
+                continue;
+            }
+            for (size_t k = done[p]; k < count; k++) {
+                uint64_t id = ((uint64_t)p << 16) | k;
+                struct io_uring_sqe *sqe;
+                
+                if (has_slot[k]) {
+                    sqe = uring_sqe(uring, IORING_OP_TIMEOUT, -1, IOSQE_IO_HARDLINK, (URING_OP_TIMEOUT << 56) | id);
+                    sqe->addr = (uint64_t)(uintptr_t)&uring->slots[k];
+                    sqe->len = 1;
+                    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+                    expected++;
+                }
+                
+                sqe = uring_sqe(uring, IORING_OP_WRITE, fds[p], IOSQE_IO_LINK, (URING_OP_WRITE << 56) | id);
+                sqe->addr = (uint64_t)(uintptr_t)&uring->bytes[k];
+                sqe->len = 1;
+                sqe->off = (uint64_t)-1;  // position courante (pas de seek sur un tty)
+                
+                sqe = uring_sqe(uring, IORING_OP_LINK_TIMEOUT, -1, k + 1 == count ? 0 : IOSQE_IO_HARDLINK, 0);
+                sqe->addr = (uint64_t)(uintptr_t)(p == 0 ? &uring->write_limit : &uring->mirror_limit);
+                sqe->len = 1;
+                expected += 2;
+            }
+        }
+        if (expected == 0) {
+            break;  // tous les ports sont servis
+        }
+        
+        if (uring_submit_wait(uring, expected) < 0) {
+            uring_fallback(uring, strerror(errno));
+            metric_add(&m->metrics.bytes_sent, done[0]);
+            return done[0];  // la suite sera rejouée par l'écriture classique
+        }
+        
+        // Complétions: dans une chaîne, les écritures réussies forment un préfixe
+        for (unsigned seen = 0; seen < expected; ) {
+            unsigned cq_head = *uring->cq_head;
+            unsigned cq_tail = atomic_load_explicit((_Atomic unsigned *)uring->cq_tail, memory_order_acquire);
+            
+            if (cq_head == cq_tail) {
+                if (syscall(__NR_io_uring_enter, uring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+                    break;
+                }
+                continue;
+            }
+            
+            for (; cq_head != cq_tail; cq_head++, seen++) {
+                struct io_uring_cqe *cqe = &uring->cqes[cq_head & *uring->cq_mask];
+                if ((cqe->user_data >> 56) == URING_OP_WRITE) {
+                    uring->results[(cqe->user_data >> 16) & 0xFF][cqe->user_data & 0xFFFF] = cqe->res;
+                    done[(cqe->user_data >> 16) & 0xFF] += cqe->res == 1;
+                }
+            }
+            atomic_store_explicit((_Atomic unsigned *)uring->cq_head, cq_head, memory_order_release);
+        }
+        
+        // Premier échec de chaque chaîne: interruption (on reprend), délai
+        // dépassé (port principal: on insiste, le watchdog surveille), erreur
+        for (int p = 0; p < nfds; p++) {
+            int res = fds[p] >= 0 && done[p] < count ? uring->results[p][done[p]] : 0;
+            
+            if (res == 0 || (p == 0 && res == -ECANCELED)) {
+                continue;
+            }
+            if (res == -EAGAIN) {
+                // Port non bloquant plein: la chaîne reprend quand il accepte
+                struct pollfd pfd = { .fd = fds[p], .events = POLLOUT };
+                if (poll(&pfd, 1, p == 0 ? OUTPUT_POLL_MS : OUTPUT_MIRROR_MS) == 0 && p > 0) {
+                    mirror_drop(e, p - 1, "port bloqué");
+                    fds[p] = -1;
+                }
+                continue;
+            }
+            if (res == -EINTR) {
+                stalled += p == 0 && done[0] == before;
+                continue;
+            }
+            if (p > 0) {
+                mirror_drop(e, p - 1, res == -ECANCELED ? "port bloqué" : strerror(-res));
+                fds[p] = -1;
+                continue;
+            }
+            metric_add(&m->metrics.write_errors, 1);
+            m->reconnect = 1;
+            atomic_store(&e->output_discard, 1);
+        }
+        
+        if (stalled >= URING_RETRIES) {
+            uring_fallback(uring, "écritures interrompues en boucle");
+            metric_add(&m->metrics.bytes_sent, done[0]);
+            return done[0];
+        }
+    }
+    
+    metric_add(&m->metrics.bytes_sent, done[0]);
+    return count;
+}
+#endif
+
+/**
+ * @brief Temps d'affichage initial (minitel_first_glyph_seconds): le
+ *        premier caractère depuis le lancement vient d'être écrit
+ */
+static void first_glyph_record(minitel_t *m, const struct timespec *now) {
+    char msg[128];
+    
+    metric_set(&m->metrics.first_glyph_us, elapsed_us(&m->engine->started, now));
+    snprintf(msg, sizeof(msg), "Premier caractère affiché %.0f ms après le lancement",
+             elapsed_us(&m->engine->started, now) / 1e3);
+    log_message("INFO", msg);
+}
+
+/**
+ * @brief Horodate le premier caractère si l'anneau a été vidé jusqu'à lui
+ * 
+ * Appelée par le fil d'écriture après chaque écriture, et par le fil
+ * principal juste après avoir posé la marque: le premier qui la retire
+ * horodate.
+ * @param upto Position de l'anneau émise jusqu'ici (tail)
+ */
+static void first_glyph_check(minitel_t *m, size_t upto) {
+    size_t at = atomic_load_explicit(&m->engine->first_glyph_at, memory_order_acquire);
+    struct timespec now;
+    
+    if (at == 0 || upto < at || !atomic_compare_exchange_strong(&m->engine->first_glyph_at, &at, 0)) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    first_glyph_record(m, &now);
+}
+
+/**
+ * @brief Fil d'écriture: vide l'anneau sur le port, au rythme demandé
+ * 
+ * Seul ce fil écrit sur les ports pendant une rafale. Son cadencement ne
+ * dépend plus de ce que fait le fil principal (log, lecture du fichier
+ * sur une carte SD lente, encodage): l'encodeur prend de l'avance dans
+ * l'anneau. Les attentes se font à échéance absolue: clock_nanosleep()
+ * entre deux octets, ou délais liés io_uring (option -U).
+ */
+static void *writer_main(void *arg) {
+    minitel_t *m = arg;
+    struct minitel_engine *e = m->engine;
+    pacer_t pacer;
+    int in_burst = 0;
+    int waiting = 0;
+    struct timespec next_at = { 0, 0 };
+    struct timespec now;
+    sigset_t all;
+    
+    // Les signaux vont au fil principal, dont l'epoll_wait doit être interrompu
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+    
+#ifdef HAVE_IO_URING
+    if (e->uring.fd >= 0 && syscall(__NR_io_uring_register, e->uring.fd, IORING_REGISTER_ENABLE_RINGS, NULL, 0) < 0) {
+        uring_fallback(&e->uring, strerror(errno));
+    }
+#endif
+    
+    while (!atomic_load(&e->writer_stop)) {
+        size_t tail = atomic_load_explicit(&e->output_ring.tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&e->output_ring.head, memory_order_acquire);
+        size_t consumed = 1;
+        
+        if (tail == head && atomic_load(&e->replay) != NULL) {
+            // Passage pré-encodé (l'anneau est vide pendant tout le passage)
+            if (!in_burst) {
+                pacer_start(&pacer, &m->metrics, atomic_load(&e->output_delay));
+                in_burst = 1;
+            }
+            writer_replay(m, atomic_load(&e->replay), e->replay_count, &pacer);
+            atomic_store(&e->replay, NULL);
+            continue;
+        }
+        
+        if (tail == head) {
+            // File vide: bilan de la rafale, puis sommeil jusqu'au prochain octet
+            if (in_burst) {
+                pacer_stop(&pacer);
+                pacer_report(&pacer, NULL);
+                e->writer_burst = pacer;
+                in_burst = 0;
+            }
+            atomic_store(&e->writer_idle, 1);
+            output_notify(e);
+            
+            if (tail == atomic_load(&e->output_ring.head) && !atomic_load(&e->writer_stop)) {
+                uint64_t wakeups;
+                if (read(e->writer_wake_fd, &wakeups, sizeof(wakeups)) < 0 && errno != EINTR) {
+                    break;
+                }
+            }
+            // Le blocage se mesure depuis le réveil, pas depuis la rafale précédente
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            atomic_store(&e->writer_progress_us, (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+            atomic_store(&e->writer_idle, 0);
+            continue;
+        }
+        
+        if (!atomic_load(&e->output_discard)) {
+            if (!in_burst) {
+                pacer_start(&pacer, &m->metrics, atomic_load(&e->output_delay));
+                waiting = 0;
+                in_burst = 1;
+            }
+            
+#ifdef HAVE_IO_URING
+            if (e->uring.fd >= 0) {
+                consumed = writer_step_uring(m, tail, head, &pacer, &next_at, &waiting);
+            } else
+#endif
+            {
+                size_t paced;
+                
+                if (waiting) {
+                    writer_sleep_until(m, &next_at);
+                    waiting = 0;
+                }
+                consumed = writer_step_poll(m, tail, head, pacer.delay, &paced);
+                if (pacer.delay <= 0) {
+                    pacer.slots += paced;
+                } else if (paced > 0) {
+                    pacer_next(&pacer);
+                    next_at = pacer.slot;
+                    waiting = 1;
+                }
+            }
+            
+            if (consumed > 0) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                atomic_store(&e->writer_progress_us, (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+                first_glyph_check(m, tail + consumed);
+            }
+        }
+        
+        atomic_store_explicit(&e->output_ring.tail, tail + consumed, memory_order_release);
+        output_notify(e);
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Démarre le fil d'écriture
+ * 
+ * Lui seul passe en temps réel (m->rt_priority, m->rt_cpu): le fil
+ * principal, qui met en page et convertit les images, reste en temps
+ * partagé et ne retarde pas ses réveils.
+ * @param use_uring Écrire via io_uring (repli sur poll() s'il est refusé)
+ */
+int output_init(minitel_t *m, int use_uring) {
+    struct minitel_engine *e = m->engine;
+    struct epoll_event ev;
+    char msg[160];
+    
+    e->writer_wake_fd = eventfd(0, EFD_CLOEXEC);
+    e->output_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (e->writer_wake_fd < 0 || e->output_wake_fd < 0) {
+        log_message("ERROR", "Création des eventfd de sortie impossible");
+        return -1;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = e->output_wake_fd;
+    if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, e->output_wake_fd, &ev) < 0) {
+        return -1;
+    }
+    
+    if (use_uring) {
+#ifdef HAVE_IO_URING
+        if (uring_init(&e->uring, URING_ENTRIES) == 0) {
+            log_message("INFO", "Écriture via io_uring (délais liés, rafales de 32 octets)");
+        } else {
+            snprintf(msg, sizeof(msg), "io_uring indisponible (%s), écriture classique", strerror(errno));
+            log_message("WARN", msg);
+        }
+#else
+        snprintf(msg, sizeof(msg), "io_uring absent à la compilation, écriture classique");
+        log_message("WARN", msg);
+#endif
+    }
+    
+    if (pthread_create(&e->writer_thread, NULL, writer_main, m) != 0) {
+        log_message("ERROR", "Création du fil d'écriture impossible");
+        return -1;
+    }
+    e->writer_started = 1;
+    
+    if ((m->rt_priority > 0 || m->rt_cpu >= 0) &&
+        realtime_setup(e->writer_thread, m->rt_policy, m->rt_priority, m->rt_cpu) > 0) {
+        log_message("WARN", "Temps réel partiellement refusé, on continue en temps partagé");
+    }
+    return 0;
+}
+
+/**
+ * @brief Arrête le fil d'écriture (la file restante est abandonnée)
+ */
+void output_shutdown(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    uint64_t one = 1;
+    
+    if (!e->writer_started) {
+        return;
+    }
+    
+    atomic_store(&e->writer_stop, 1);
+    if (write(e->writer_wake_fd, &one, sizeof(one)) < 0) {
+        log_message("WARN", "Réveil du fil d'écriture impossible");
+    }
+    pthread_join(e->writer_thread, NULL);
+    e->writer_started = 0;
+#ifdef HAVE_IO_URING
+    if (e->uring.fd >= 0) {
+        close(e->uring.fd);
+        e->uring.fd = -1;
+    }
+#endif
+}
+
+/**
+ * @brief Attend, en servant la boucle d'événements, que la condition soit vraie
+ * @param need Nombre de places libres voulues dans l'anneau (0: file vide
+ *        et fil d'écriture au repos)
+ * @return 0 si obtenu, -1 si arrêt ou reconnexion
+ */
+static int output_wait(minitel_t *m, size_t need) {
+    struct minitel_engine *e = m->engine;
+    
+    for (;;) {
+        atomic_store(&e->output_waiting, 1);
+        
+        int ready = need == 0 ? output_pending(e) == 0 && atomic_load(&e->writer_idle)
+                              : OUTPUT_RING_SIZE - output_pending(e) >= need;
+        if (ready || !e->writer_started) {
+            atomic_store(&e->output_waiting, 0);
+            return 0;
+        }
+        
+        if (event_wait(m, OUTPUT_WAIT_US, 0) < 0) {
+            atomic_store(&e->output_waiting, 0);
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Attend que tout ce qui est en file soit parti sur le port
+ */
+int output_flush(minitel_t *m) {
+    return output_wait(m, 0);
+}
+
+/**
+ * @brief Compte les caractères affichés depuis before (m->screen.glyphs)
+ * @return 1 si ce sont les tout premiers depuis le lancement
+ */
+static int glyphs_count(minitel_t *m, uint64_t before) {
+    uint64_t n = m->screen.glyphs - before;
+    
+    return n > 0 && atomic_fetch_add_explicit(&m->metrics.glyphs_sent, n, memory_order_relaxed) == 0;
+}
+
+/**
+ * @brief Met des octets en file pour le fil d'écriture
+ * 
+ * Le modèle d'écran est tenu à jour tout de suite: l'encodeur calcule
+ * ses différences par rapport à ce qui sera affiché une fois la file
+ * vidée (la capture SIGUSR1 montre donc l'écran avec un peu d'avance).
+ * @param delay µs par octet; 0 pour des octets sans créneau (retours ligne)
+ */
+int output_queue(minitel_t *m, const void *buf, size_t len, long delay) {
+    struct minitel_engine *e = m->engine;
+    const uint8_t *bytes = buf;
+    uint64_t glyphs = m->screen.glyphs;
+    uint64_t one = 1;
+    size_t start;
+    size_t fed = 0;
+    
+    if (m->fd != atomic_load(&e->output_fd) || (delay > 0 && delay != atomic_load(&e->output_delay))) {
+        if (output_flush(m) < 0) {
+            return -1;
+        }
+        atomic_store(&e->output_fd, m->fd);
+        if (delay > 0) {
+            atomic_store(&e->output_delay, delay);
+        }
+    }
+    
+    start = atomic_load_explicit(&e->output_ring.head, memory_order_relaxed);
+    for (size_t i = 0; i < len; i++) {
+        size_t head = atomic_load_explicit(&e->output_ring.head, memory_order_relaxed);
+        
+        if (head - atomic_load_explicit(&e->output_ring.tail, memory_order_acquire) >= OUTPUT_RING_SIZE &&
+            output_wait(m, 1) < 0) {
+            return -1;
+        }
+        
+        e->output_ring.slots[head & (OUTPUT_RING_SIZE - 1)] = (uint16_t)(bytes[i] | (delay > 0 ? OUTPUT_PACED : 0));
+        atomic_store_explicit(&e->output_ring.head, head + 1, memory_order_release);
+        
+        if (atomic_load(&e->writer_idle) && write(e->writer_wake_fd, &one, sizeof(one)) < 0) {
+            return -1;
+        }
+    }
+    
+    // Rien encore affiché: le premier caractère est repéré octet par octet,
+    // puis horodaté par le fil d'écriture quand il part sur le port
+    if (atomic_load_explicit(&m->metrics.glyphs_sent, memory_order_relaxed) == 0) {
+        while (fed < len && m->screen.glyphs == glyphs) {
+            screen_feed(&m->screen, bytes + fed++, 1);
+        }
+        if (m->screen.glyphs != glyphs) {
+            atomic_store_explicit(&e->first_glyph_at, start + fed, memory_order_release);
+            first_glyph_check(m, atomic_load_explicit(&e->output_ring.tail, memory_order_acquire));
+        }
+    }
+    screen_feed(&m->screen, bytes + fed, len - fed);
+    glyphs_count(m, glyphs);
+    return 0;
+}
+
+/**
+ * @brief Avance le modèle d'écran jusqu'à upto octets du passage
+ */
+static void replay_feed(minitel_t *m, const output_segment_t *segs, int count, replay_cursor_t *at, uint64_t upto) {
+    uint64_t glyphs = m->screen.glyphs;
+    
+    while (at->bytes < upto && at->seg < count) {
+        uint32_t take = segs[at->seg].len - at->off;
+        
+        if (take > upto - at->bytes) {
+            take = (uint32_t)(upto - at->bytes);
+        }
+        screen_feed(&m->screen, segs[at->seg].base + at->off, take);
+        at->off += take;
+        at->bytes += take;
+        if (at->off == segs[at->seg].len) {
+            at->seg++;
+            at->off = 0;
+        }
+    }
+    
+    // Octets déjà écrits (replay_done): l'heure est celle de l'émission
+    if (glyphs_count(m, glyphs)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        first_glyph_record(m, &now);
+    }
+    metric_set(&m->metrics.offset, (int64_t)at->bytes);
+}
+
+/**
+ * @brief Fait rejouer un passage pré-encodé par le fil d'écriture
+ * 
+ * Rien n'est copié: segs et les tampons qu'ils désignent doivent rester
+ * en place jusqu'au retour. La boucle d'événements tourne pendant
+ * l'envoi, que m->interrupt, l'arrêt ou la perte du port interrompent;
+ * le modèle d'écran suit les octets réellement écrits.
+ * @param sent Octets du passage écrits sur le port (peut être NULL)
+ * @return 0 si le passage est fini ou interrompu, -1 si le port est perdu
+ */
+int output_replay(minitel_t *m, const output_segment_t *segs, int count, long delay, uint64_t *sent) {
+    struct minitel_engine *e = m->engine;
+    struct pollfd pfd = { .fd = e->output_wake_fd, .events = POLLIN };
+    replay_cursor_t fed = { 0, 0, 0 };
+    uint64_t one = 1;
+    int lost = 0;
+    
+    if (!e->writer_started || output_flush(m) < 0) {
+        return -1;
+    }
+    atomic_store(&e->output_fd, m->fd);
+    if (delay > 0) {
+        atomic_store(&e->output_delay, delay);
+    }
+    
+    e->replay_count = count;
+    atomic_store(&e->replay_done, 0);
+    atomic_store(&e->replay_stop, 0);
+    atomic_store(&e->output_waiting, 1);
+    atomic_store(&e->replay, segs);
+    if (write(e->writer_wake_fd, &one, sizeof(one)) < 0) {
+        atomic_store(&e->replay_stop, 1);
+    }
+    
+    // Le fil d'écriture rend la liste en remettant replay à NULL
+    while (atomic_load(&e->replay) != NULL) {
+        if (!atomic_load(&e->replay_stop) && (m->interrupt || !m->running || !check_serial_connection(m->fd))) {
+            lost = m->running && !m->interrupt;
+            atomic_store(&e->replay_stop, 1);
+        }
+        
+        if (atomic_load(&e->replay_stop)) {
+            uint64_t wakeups;
+            if (poll(&pfd, 1, OUTPUT_POLL_MS) > 0 && read(e->output_wake_fd, &wakeups, sizeof(wakeups)) < 0) {
+                break;
+            }
+        } else if (event_wait(m, OUTPUT_WAIT_US, 0) < 0) {
+            atomic_store(&e->replay_stop, 1);
+        }
+        
+        replay_feed(m, segs, count, &fed, atomic_load(&e->replay_done));
+    }
+    atomic_store(&e->output_waiting, 0);
+    atomic_store(&e->replay_stop, 0);  // l'anneau reprend, writer_putv ne doit plus s'arrêter
+    replay_feed(m, segs, count, &fed, atomic_load(&e->replay_done));
+    
+    if (sent != NULL) {
+        *sent = fed.bytes;
+    }
+    return lost || atomic_load(&e->output_discard) ? -1 : 0;
+}
+
+/**
+ * @brief Abandonne la file (port perdu ou fermé) et détache le port
+ */
+void output_detach(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    struct pollfd pfd = { .fd = e->output_wake_fd, .events = POLLIN };
+    
+    if (!e->writer_started) {
+        return;
+    }
+    
+    atomic_store(&e->output_discard, 1);
+    atomic_store(&e->output_waiting, 1);
+    while (output_pending(e) > 0 || !atomic_load(&e->writer_idle)) {
+        uint64_t wakeups;
+        if (poll(&pfd, 1, OUTPUT_POLL_MS) > 0 && read(e->output_wake_fd, &wakeups, sizeof(wakeups)) < 0) {
+            break;
+        }
+    }
+    atomic_store(&e->output_waiting, 0);
+    atomic_store(&e->output_fd, -1);
+    atomic_store(&e->output_discard, 0);
+}
+
+/**
+ * @brief Écrit vers le Minitel hors rafale (sonde, effacement, commandes)
+ * 
+ * Les octets passent par l'anneau, derrière ce qui y attend déjà: l'ordre
+ * est gardé, le fil d'écriture reprend les écritures partielles, et la
+ * boucle d'événements tourne jusqu'au dernier octet (signaux, commandes,
+ * watchdog), même si le port ne prend plus rien.
+ * @return len une fois tout écrit, -1 si arrêt ou port perdu
+ */
+ssize_t serial_write(minitel_t *m, const void *buf, size_t len) {
+    if (output_queue(m, buf, len, 0) < 0 || output_flush(m) < 0 || atomic_load(&m->engine->output_discard)) {
+        return -1;
+    }
+    return (ssize_t)len;
+}
+
+/**
+ * @brief Attend que le pilote série ait tout émis, en servant la boucle d'événements
+ * 
+ * Remplace tcdrain(), qui bloque sans limite si la ligne n'avance plus:
+ * la file du pilote (TIOCOUTQ) est relevée entre deux attentes calées
+ * sur la vitesse du terminal, puis on laisse le temps de vider la FIFO
+ * de l'UART.
+ * @param timeout_ms Attente maximale
+ * @return 0 si tout est parti, -1 si arrêt, port perdu ou délai dépassé
+ */
+int output_drain(minitel_t *m, int timeout_ms) {
+    long char_us = 10000000L / (m->terminal.speed > 0 ? m->terminal.speed : DEFAULT_SPEED);  // 10 bits
+    struct timespec deadline, now;
+    int queued;
+    
+    if (output_flush(m) < 0 || atomic_load(&m->engine->output_discard)) {
+        return -1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    timespec_add_us(&deadline, (long)timeout_ms * 1000);
+    while (ioctl(m->fd, TIOCOUTQ, &queued) == 0 && queued > 0) {
+        long wait = queued * char_us;
+        
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (elapsed_us(&now, &deadline) <= 0) {
+            return -1;
+        }
+        if (event_wait(m, wait < OUTPUT_WAIT_US ? wait : OUTPUT_WAIT_US, 0) < 0) {
+            return -1;
+        }
+    }
+    
+    return event_wait(m, SERIAL_FIFO_BYTES * char_us, 0) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Vérifie si le port série est toujours connecté
+ */
+int check_serial_connection(int fd) {
+    char test_byte = 0;
+    int result;
+    
+    if (fd < 0) {
+        return 0;
+    }
+    
+    // Test non-bloquant
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    
+    result = write(fd, &test_byte, 0);
+    
+    fcntl(fd, F_SETFL, flags);
+    
+    if (result < 0 && errno == EBADF) {
+        return 0;
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief Ouvre et configure le port série
+ */
+int open_serial_port(const char *port) {
+    int fd;
+    struct termios options;
+    char msg[256];
+    
+    fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", port, strerror(errno));
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    // Configuration port série
+    if (tcgetattr(fd, &options) < 0) {
+        log_message("ERROR", "tcgetattr failed");
+        close(fd);
+        return -1;
+    }
+    
+    cfsetispeed(&options, BAUDRATE);
+    cfsetospeed(&options, BAUDRATE);
+    cfmakeraw(&options);
+    
+    // Lectures sans attente: les délais passent par poll() et epoll
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
+    
+    if (tcsetattr(fd, TCSANOW, &options) < 0) {
+        log_message("ERROR", "tcsetattr failed");
+        close(fd);
+        return -1;
+    }
+    
+    // Le port reste non bloquant: le fil d'écriture n'écrit que ce que le
+    // pilote accepte (POLLOUT), le reste attend dans l'anneau
+    
+    snprintf(msg, sizeof(msg), "Port série %s ouvert avec succès", port);
+    log_message("INFO", msg);
+    
+    return fd;
+}
+
+/**
+ * @brief Ouvre les ports miroirs, qui recevront les mêmes octets que le port principal
+ * 
+ * Ouverts après la sonde: l'identification et le changement de vitesse
+ * ne concernent que le port principal. Un miroir absent est ignoré.
+ * @return nombre de miroirs ouverts
+ */
+int mirrors_open(minitel_t *m, const char *ports[], int count) {
+    struct minitel_engine *e = m->engine;
+    int opened = 0;
+    
+    for (int k = 0; k < count && k < OUTPUT_MAX_MIRRORS; k++) {
+        e->mirror_fds[k] = open_serial_port(ports[k]);
+        atomic_store(&e->output_mirrors[k], e->mirror_fds[k]);
+        opened += e->mirror_fds[k] >= 0;
+    }
+    return opened;
+}
+
+/**
+ * @brief Ferme les ports miroirs (file d'écriture déjà détachée)
+ */
+void mirrors_close(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    
+    for (int k = 0; k < OUTPUT_MAX_MIRRORS; k++) {
+        atomic_store(&e->output_mirrors[k], -1);
+        if (e->mirror_fds[k] >= 0) {
+            close(e->mirror_fds[k]);
+            e->mirror_fds[k] = -1;
+        }
+    }
+}
+
+/**
+ * @brief Ferme le port principal et les miroirs (la file en attente est abandonnée)
+ */
+void minitel_disconnect(minitel_t *m) {
+    output_detach(m);
+    mirrors_close(m);
+    event_loop_set_serial(m, -1);
+    if (m->fd >= 0) {
+        close(m->fd);
+        m->fd = -1;
+    }
+}
+
+/**
+ * @brief Libère un contexte: port, fil d'écriture, boucle d'événements
+ */
+void minitel_close(minitel_t *m) {
+    struct minitel_engine *e = m->engine;
+    
+    if (e == NULL) {
+        return;
+    }
+    
+    int fds[] = { e->epoll_fd, e->pace_timer_fd, e->watchdog_timer_fd, e->metrics_timer_fd,
+                  e->writer_wake_fd, e->output_wake_fd };
+    
+    minitel_disconnect(m);
+    output_shutdown(m);
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    free(e);
+    m->engine = NULL;
+}
+
+/**
+ * @brief Initialise l'écran du Minitel
+ */
+int init_minitel_screen(minitel_t *m) {
+    if (m->fd < 0 || !check_serial_connection(m->fd)) {
+        return -1;
+    }
+    
+    // Effacer l'écran, et attendre que l'effacement soit parti plutôt qu'un délai fixe
+    if (serial_write(m, "\x0C", 1) < 0 || output_drain(m, PROBE_TIMEOUT_MS) < 0) {
+        log_message("ERROR", "Erreur écriture clear screen");
+        return -1;
+    }
+    
+    // Sauter 10 lignes
+    if (serial_write(m, "\n\n\n\n\n\n\n\n\n\n", 10) < 0) {
+        log_message("ERROR", "Erreur écriture lignes");
+        return -1;
+    }
+    
+    log_message("INFO", "Écran Minitel initialisé");
+    return 0;
+}
+
+/**
+ * @brief Bloc d'une arène, suivi de ses allocations
+ */
+struct arena_block {
+    struct arena_block *prev;
+    size_t size;            // octets projetés, en-tête compris
+    size_t top;             // premier octet libre, depuis le début du bloc
+};
+
+#define ARENA_HEADER  ((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_ROUND(n, to) (((n) + (to) - 1) & ~(size_t)((to) - 1))
+
+/**
+ * @brief Compte les octets projetés ou rendus et tient le plus haut niveau
+ */
+static void arena_account(arena_t *arena, size_t added, size_t removed) {
+    size_t now = atomic_fetch_add(&arena_total, added - removed) + added - removed;
+    size_t peak = atomic_load(&arena_peak);
+    
+    arena->reserved += added - removed;
+    while (now > peak && !atomic_compare_exchange_weak(&arena_peak, &peak, now)) {
+    }
+}
+
+/**
+ * @brief Projette un nouveau bloc d'au moins need octets utiles
+ */
+static struct arena_block *arena_block_new(arena_t *arena, size_t need) {
+    size_t size = ARENA_ROUND(ARENA_HEADER + need, ARENA_PAGE);
+    struct arena_block *block;
+    
+    if (size < ARENA_BLOCK) {
+        size = ARENA_BLOCK;
+    }
+    block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        return NULL;
+    }
+    block->prev = arena->head;
+    block->size = size;
+    block->top = ARENA_HEADER;
+    arena->head = block;
+    arena_account(arena, size, 0);
+    return block;
+}
+
+/**
+ * @brief Alloue size octets dans l'arène (alignés sur 16)
+ * 
+ * Sans arène (NULL), l'allocation vient du tas: à libérer avec free().
+ * @return Pointeur, NULL si la mémoire manque
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+    struct arena_block *block;
+    void *ptr;
+    
+    if (arena == NULL) {
+        return malloc(size);
+    }
+    
+    size = ARENA_ROUND(size, ARENA_ALIGN);
+    block = arena->head;
+    if (block == NULL || block->size - block->top < size) {
+        block = arena_block_new(arena, size);
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+    ptr = (uint8_t *)block + block->top;
+    block->top += size;
+    arena->used += size;
+    return ptr;
+}
+
+/**
+ * @brief Agrandit (ou réduit) une allocation de l'arène, comme realloc()
+ * 
+ * La dernière allocation du bloc courant change de taille sur place;
+ * seule dans son bloc, elle le fait suivre par mremap() sans copie, de
+ * sorte qu'un tableau agrandi page par page ne laisse pas de copies
+ * derrière lui. Sinon, la nouvelle place est prise plus loin et
+ * l'ancienne reste perdue jusqu'à arena_free(). Une réduction ne
+ * déplace jamais rien et ne peut pas échouer.
+ * @return Nouveau pointeur, NULL si la mémoire manque (ptr reste valide)
+ */
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+    struct arena_block *block;
+    size_t old_end, new_end, start;
+    void *fresh;
+    
+    if (arena == NULL) {
+        return realloc(ptr, new_size);
+    }
+    if (ptr == NULL) {
+        return arena_alloc(arena, new_size);
+    }
+    
+    old_end = ARENA_ROUND(old_size, ARENA_ALIGN);
+    new_end = ARENA_ROUND(new_size, ARENA_ALIGN);
+    block = arena->head;
+    start = (size_t)((uint8_t *)ptr - (uint8_t *)block);
+    
+    // Dernière allocation du bloc courant: la fin du bloc bouge seule
+    if (block != NULL && (uint8_t *)ptr > (uint8_t *)block && start + old_end == block->top) {
+        if (start + new_end <= block->size) {
+            size_t keep;
+            
+            block->top = start + new_end;
+            arena->used = arena->used - old_end + new_end;
+            
+            // Grosse réduction: la fin du bloc retourne au système
+            keep = ARENA_ROUND(block->top, ARENA_PAGE);
+            if (keep < ARENA_BLOCK) {
+                keep = ARENA_BLOCK;
+            }
+            if (block->size - keep >= ARENA_BLOCK && munmap((uint8_t *)block + keep, block->size - keep) == 0) {
+                arena_account(arena, 0, block->size - keep);
+                block->size = keep;
+            }
+            return ptr;
+        }
+        
+        if (start == ARENA_HEADER) {
+            // Seule dans le bloc: le noyau déplace les pages, le bloc double
+            size_t size = ARENA_ROUND(ARENA_HEADER + new_end, ARENA_PAGE);
+            size_t old_block = block->size;
+            struct arena_block *moved;
+            
+            if (size < 2 * old_block) {
+                size = 2 * old_block;
+            }
+            moved = mremap(block, old_block, size, MREMAP_MAYMOVE);
+            if (moved == MAP_FAILED) {
+                return NULL;
+            }
+            moved->size = size;
+            moved->top = ARENA_HEADER + new_end;
+            arena->head = moved;
+            arena->used = arena->used - old_end + new_end;
+            arena_account(arena, size, old_block);
+            return (uint8_t *)moved + ARENA_HEADER;
+        }
+    }
+    
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    fresh = arena_alloc(arena, new_size);
+    if (fresh != NULL) {
+        memcpy(fresh, ptr, old_size);
+    }
+    return fresh;
+}
+
+/**
+ * @brief Repère l'état de l'arène, pour y revenir avec arena_release()
+ */
+arena_mark_t arena_mark(const arena_t *arena) {
+    return (arena_mark_t){ arena->head, arena->head ? arena->head->top : 0, arena->used };
+}
+
+/**
+ * @brief Libère tout ce qui a été alloué depuis le repère
+ * 
+ * Les blocs projetés après le repère sont rendus au système. Une
+ * allocation antérieure au repère ne doit pas avoir été agrandie depuis.
+ */
+void arena_release(arena_t *arena, arena_mark_t mark) {
+    while (arena->head != NULL && arena->head != mark.block) {
+        struct arena_block *block = arena->head;
+        
+        arena->head = block->prev;
+        arena_account(arena, 0, block->size);
+        munmap(block, block->size);
+    }
+    if (arena->head != NULL) {
+        arena->head->top = mark.top;
+    }
+    arena->used = mark.used;
+}
+
+/**
+ * @brief Rend tous les blocs de l'arène au système
+ */
+void arena_free(arena_t *arena) {
+    arena_release(arena, (arena_mark_t){ NULL, 0, 0 });
+}
+
+/**
+ * @brief Octets projetés par toutes les arènes du processus, et plus haut niveau
+ */
+void arena_stats(size_t *reserved, size_t *peak) {
+    *reserved = atomic_load(&arena_total);
+    *peak = atomic_load(&arena_peak);
+}
+
+/**
+ * @brief Charge un fichier entier en mémoire, terminé par '\0' (à libérer avec free)
+ */
+static char *read_file(const char *filename, size_t *len) {
+    FILE *file;
+    char *data;
+    long size;
+    char msg[400];
+    
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", filename, strerror(errno));
+        log_message("ERROR", msg);
+        return NULL;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    data = malloc((size_t)size + 1);
+    if (data == NULL) {
+        log_message("ERROR", "Mémoire insuffisante");
+        fclose(file);
+        return NULL;
+    }
+    
+    *len = fread(data, 1, (size_t)size, file);
+    data[*len] = '\0';
+    fclose(file);
+    return data;
+}
+
+/**
+ * @brief Remplace les séquences UTF-8 invalides par '?' et les signale
+ */
+static void text_sanitize(char *data, size_t len, const char *filename) {
+    size_t first = 0;
+    size_t invalid = utf8_sanitize(data, len, &first);
+    char msg[400];
+    
+    if (invalid > 0) {
+        snprintf(msg, sizeof(msg), "%s: %zu octet(s) UTF-8 invalide(s) remplacé(s) par '?' (premier à l'octet %zu)",
+                 filename, invalid, first);
+        log_message("WARN", msg);
+    }
+}
+
+/**
+ * @brief Charge un fichier texte entier en mémoire (à libérer avec free)
+ * 
+ * Le texte est validé au chargement: les séquences UTF-8 invalides sont
+ * remplacées par '?' (utf8_sanitize) et signalées dans le journal.
+ */
+char *load_text_file(const char *filename, size_t *len) {
+    char *data = read_file(filename, len);
+    
+    if (data != NULL) {
+        text_sanitize(data, *len, filename);
+    }
+    return data;
+}
+
+/**
+ * @brief Longueur du préfixe ASCII (octets < 0x80)
+ * 
+ * Par blocs de 16 octets (SSE2 ou NEON), 32 avec AVX2; la fin du texte et
+ * le bloc qui contient le premier octet non ASCII sont finis un à un.
+ */
+static size_t ascii_span(const uint8_t *s, size_t len) {
+    size_t i = 0;
+    
+#if defined(__AVX2__)
+    for (; i + 32 <= len; i += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(s + i)));
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(s + i);
+        uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+        if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+#endif
+    
+    while (i < len && s[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @brief Longueur du préfixe de texte ordinaire: ASCII imprimable sans '{'
+ * 
+ * Ces octets passent tels quels dans le flux compilé (compile_markup).
+ */
+static size_t text_plain_span(const uint8_t *s, size_t len) {
+    size_t i = 0;
+    
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i brace = _mm_set1_epi8('{');
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        // Comparaisons signées: les octets >= 0x80 sont négatifs, donc exclus
+        __m128i ok = _mm_andnot_si128(_mm_cmplt_epi8(v, below), _mm_cmplt_epi8(v, del));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi8(v, brace), ok)) & 0xFFFF;
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(s + i);
+        uint8x16_t ok = vandq_u8(vcgeq_u8(v, vdupq_n_u8(0x20)), vcltq_u8(v, vdupq_n_u8(0x7F)));
+        uint8x8_t folded;
+        ok = vbicq_u8(ok, vceqq_u8(v, vdupq_n_u8('{')));
+        folded = vand_u8(vget_low_u8(ok), vget_high_u8(ok));
+        if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) != ~0ULL) {
+            break;
+        }
+    }
+#endif
+    
+    while (i < len && s[i] >= 0x20 && s[i] < 0x7F && s[i] != '{') {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @brief Valide un texte UTF-8 et remplace sur place les séquences invalides
+ * 
+ * Les plages ASCII sont sautées par blocs (ascii_span), seuls les
+ * caractères non ASCII passent par utf8_decode(). Chaque octet d'une
+ * séquence invalide devient '?', le glyphe de U+FFFD sur le Minitel: la
+ * longueur du texte ne change pas.
+ * @return Nombre d'octets remplacés (le premier à *first_invalid)
+ */
+size_t utf8_sanitize(char *text, size_t len, size_t *first_invalid) {
+    unsigned char *s = (unsigned char *)text;
+    size_t replaced = 0;
+    size_t i = 0;
+    
+    for (;;) {
+        uint32_t cp;
+        int n;
+        
+        i += ascii_span(s + i, len - i);
+        if (i >= len) {
+            break;
+        }
+        
+        n = utf8_decode(s + i, len - i, &cp);
+        if (n == 1) {  // octet non ASCII seul: séquence invalide
+            if (replaced == 0 && first_invalid != NULL) {
+                *first_invalid = i;
+            }
+            s[i] = '?';
+            replaced++;
+        }
+        i += (size_t)n;
+    }
+    
+    return replaced;
+}
+
+/**
+ * @brief Décode un caractère UTF-8
+ * 
+ * Strict: les formes trop longues, les demi-codets UTF-16 (U+D800 à
+ * U+DFFF) et les valeurs au-delà de U+10FFFF sont invalides.
+ * @return Nombre d'octets consommés (1 pour une séquence invalide)
+ */
+int utf8_decode(const unsigned char *s, size_t len, uint32_t *cp) {
+    static const uint32_t min_cp[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+    int n;
+    uint32_t c = s[0];
+    
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    } else if ((c & 0xE0) == 0xC0) {
+        n = 2;
+        c &= 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        n = 3;
+        c &= 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        n = 4;
+        c &= 0x07;
+    } else {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    
+    if ((size_t)n > len) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    
+    for (int i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return 1;
+        }
+        c = (c << 6) | (s[i] & 0x3F);
+    }
+    
+    if (c < min_cp[n] || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    
+    *cp = c;
+    return n;
+}
+
+/**
+ * @brief Convertit un point de code en glyphe Vidéotex (SS2 << 8 | caractère)
+ * 
+ * Les minuscules accentuées passent par le jeu G2 (SS2 + accent + lettre),
+ * les majuscules accentuées perdent leur accent (absentes du Minitel).
+ */
+uint16_t videotex_glyph(uint32_t cp) {
+    if (cp >= 0x20 && cp < 0x7F) {
+        return (uint16_t)cp;
+    }
+    
+    switch (cp) {
+        case 0x00E0: return 0x4100 | 'a';   // à
+        case 0x00E2: return 0x4300 | 'a';   // â
+        case 0x00E4: return 0x4800 | 'a';   // ä
+        case 0x00E7: return 0x4B00 | 'c';   // ç
+        case 0x00E8: return 0x4100 | 'e';   // è
+        case 0x00E9: return 0x4200 | 'e';   // é
+        case 0x00EA: return 0x4300 | 'e';   // ê
+        case 0x00EB: return 0x4800 | 'e';   // ë
+        case 0x00EE: return 0x4300 | 'i';   // î
+        case 0x00EF: return 0x4800 | 'i';   // ï
+        case 0x00F4: return 0x4300 | 'o';   // ô
+        case 0x00F6: return 0x4800 | 'o';   // ö
+        case 0x00F9: return 0x4100 | 'u';   // ù
+        case 0x00FB: return 0x4300 | 'u';   // û
+        case 0x00FC: return 0x4800 | 'u';   // ü
+        case 0x0153: return 0x7A00;         // œ
+        case 0x0152: return 0x6A00;         // Œ
+        case 0x00DF: return 0x7B00;         // ß
+        case 0x00A3: return 0x2300;         // £
+        case 0x00A7: return 0x2700;         // §
+        case 0x00B0: return 0x3000;         // °
+        case 0x00B1: return 0x3100;         // ±
+        case 0x00C0: case 0x00C2: return 'A';
+        case 0x00C7: return 'C';
+        case 0x00C8: case 0x00C9: case 0x00CA: case 0x00CB: return 'E';
+        case 0x00CE: case 0x00CF: return 'I';
+        case 0x00D4: return 'O';
+        case 0x00D9: case 0x00DB: return 'U';
+        case 0x00A0: return ' ';            // espace insécable
+        case 0x2018: case 0x2019: return '\'';
+        case 0x00AB: case 0x00BB: case 0x201C: case 0x201D: return '"';
+        case 0x2013: case 0x2014: return '-';
+        case 0x2026: return '.';
+        case '\t': return ' ';
+        default: return '?';
+    }
+}
+
+/**
+ * @brief Interprète une balise de mise en forme à la position s
+ * 
+ * Balises: {dbl} double grandeur, {dh} double hauteur, {dw} double
+ * largeur, {inv} inversion, {blink} clignotement, {c:N} couleur (ou
+ * niveau de gris) du texte, {f:N} couleur du fond, N de 0 à 7. {/xxx}
+ * ferme la balise xxx, {/} revient aux attributs par défaut. Les
+ * attributs s'arrêtent en fin de ligne. {{ donne une accolade.
+ * @return Nombre d'octets consommés, 0 si ce n'est pas une balise
+ */
+size_t markup_tag(const char *s, size_t len, uint16_t *attr) {
+    static const struct {
+        const char *name;
+        uint16_t mask;
+    } flags[] = {
+        { "dbl", ATTR_DBL_HEIGHT | ATTR_DBL_WIDTH },
+        { "dh", ATTR_DBL_HEIGHT },
+        { "dw", ATTR_DBL_WIDTH },
+        { "inv", ATTR_INVERSE },
+        { "blink", ATTR_BLINK },
+    };
+    const char *end;
+    const char *name;
+    size_t name_len;
+    int closing;
+    
+    if (len < 3 || s[0] != '{') {
+        return 0;
+    }
+    
+    end = memchr(s, '}', len < 16 ? len : 16);
+    if (end == NULL) {
+        return 0;
+    }
+    
+    name = s + 1;
+    closing = *name == '/';
+    if (closing) {
+        name++;
+    }
+    name_len = (size_t)(end - name);
+    
+    if (closing && name_len == 0) {
+        *attr = ATTR_DEFAULT;
+        return (size_t)(end - s) + 1;
+    }
+    
+    for (size_t k = 0; k < sizeof(flags) / sizeof(flags[0]); k++) {
+        if (strlen(flags[k].name) == name_len && memcmp(name, flags[k].name, name_len) == 0) {
+            *attr = closing ? (uint16_t)(*attr & ~flags[k].mask) : (uint16_t)(*attr | flags[k].mask);
+            return (size_t)(end - s) + 1;
+        }
+    }
+    
+    if (name_len >= 1 && (name[0] == 'c' || name[0] == 'f')) {
+        int fg = name[0] == 'c';
+        uint16_t mask = fg ? ATTR_FG_MASK : ATTR_BG_MASK;
+        uint16_t def = ATTR_DEFAULT & mask;
+        
+        if (closing && name_len == 1) {
+            *attr = (uint16_t)((*attr & ~mask) | def);
+            return (size_t)(end - s) + 1;
+        }
+        if (!closing && name_len == 3 && name[1] == ':' && name[2] >= '0' && name[2] <= '7') {
+            uint16_t v = (uint16_t)(name[2] - '0');
+            *attr = (uint16_t)((*attr & ~mask) | (fg ? v : (uint16_t)(v << ATTR_BG_SHIFT)));
+            return (size_t)(end - s) + 1;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Écrit une cellule de page et marque les cellules que couvre un double format
+ */
+static void layout_put(screen_cells_t *page, int row, int col, uint16_t glyph, uint16_t attr) {
+    int idx = row * SCREEN_COLS + col;
+    
+    page->ch[idx] = (uint8_t)(glyph & 0xFF);
+    page->g2[idx] = (uint8_t)(glyph >> 8);
+    page->attr[idx] = attr;
+    
+    // Cellules couvertes: ch = 0 et g2 = 0, comme dans le modèle d'écran
+    if ((attr & ATTR_DBL_WIDTH) && col + 1 < SCREEN_COLS) {
+        page->ch[idx + 1] = 0;
+        page->g2[idx + 1] = 0;
+        page->attr[idx + 1] = attr;
+    }
+    if ((attr & ATTR_DBL_HEIGHT) && row > 1) {
+        for (int k = 0; k <= ((attr & ATTR_DBL_WIDTH) && col + 1 < SCREEN_COLS ? 1 : 0); k++) {
+            page->ch[idx - SCREEN_COLS + k] = 0;
+            page->g2[idx - SCREEN_COLS + k] = 0;
+            page->attr[idx - SCREEN_COLS + k] = attr;
+        }
+    }
+}
+
+/**
+ * @brief Met en page le texte en écrans de 40x24 (retour à la ligne par mot)
+ * 
+ * Les balises de mise en forme sont appliquées aux cellules. Une ligne
+ * en double hauteur occupe aussi la rangée du dessus; un mot en double
+ * hauteur au milieu d'une ligne simple passe donc à la ligne suivante.
+ * @return Nombre de pages (tableau pris dans l'arène, ou sur le tas à
+ *         libérer si arena est NULL), -1 si la mémoire manque
+ */
+int layout_pages(arena_t *arena, const char *text, size_t len, screen_cells_t **pages_out) {
+    const unsigned char *s = (const unsigned char *)text;
+    screen_cells_t *pages = NULL;
+    uint16_t word[SCREEN_COLS];
+    uint16_t word_attr[SCREEN_COLS];
+    int word_len = 0;
+    int word_width = 0;
+    int word_tall = 0;
+    uint16_t attr = ATTR_DEFAULT;
+    uint16_t space_attr = ATTR_DEFAULT;
+    int npages = 0;
+    int row = SCREEN_ROWS;  // force l'ouverture d'une première page
+    int col = 0;
+    int wrapped = 0;
+    int line_tall = 0;      // la ligne courante a réservé la rangée du dessus
+    size_t i = 0;
+    
+    while (i <= len) {
+        uint32_t cp = '\n';
+        
+        if (i < len) {
+            if (s[i] > 0x20 && s[i] < 0x7F && s[i] != '{') {
+                cp = s[i++];  // caractère ordinaire: ni balise ni UTF-8
+            } else if (s[i] == '{' && i + 1 < len && s[i + 1] == '{') {
+                cp = '{';
+                i += 2;
+            } else {
+                size_t tag = markup_tag(text + i, len - i, &attr);
+                if (tag > 0) {
+                    i += tag;
+                    continue;
+                }
+                i += utf8_decode(s + i, len - i, &cp);
+            }
+        } else {
+            i++;  // fin de texte: vide le dernier mot
+        }
+        
+        if (cp == '\r') {
+            continue;
+        }
+        
+        // Accumuler le mot courant
+        if (cp != ' ' && cp != '\n' && cp != '\t') {
+            word[word_len] = videotex_glyph(cp);
+            word_attr[word_len] = attr;
+            word_width += (attr & ATTR_DBL_WIDTH) ? 2 : 1;
+            word_tall |= (attr & ATTR_DBL_HEIGHT) != 0;
+            word_len++;
+            if (word_width + 2 <= SCREEN_COLS) {
+                continue;
+            }
+        }
+        
+        // Placer le mot (ou le morceau de mot trop long)
+        if (word_len > 0) {
+            int space = col > 0 ? ((space_attr & ATTR_DBL_WIDTH) ? 2 : 1) : 0;
+            
+            // La rangée du dessus d'une ligne simple est déjà écrite
+            if (col > 0 && (col + space + word_width > SCREEN_COLS || (word_tall && !line_tall))) {
+                row++;
+                col = 0;
+                space = 0;
+                line_tall = 0;
+            }
+            
+            // La double hauteur déborde sur la rangée du dessus
+            if (row + (word_tall && col == 0) >= SCREEN_ROWS) {
+                screen_cells_t *grown = arena_grow(arena, pages, (size_t)npages * sizeof(screen_cells_t),
+                                                   (size_t)(npages + 1) * sizeof(screen_cells_t));
+                if (grown == NULL) {
+                    if (arena == NULL) {
+                        free(pages);
+                    }
+                    return -1;
+                }
+                pages = grown;
+                memset(pages[npages].ch, ' ', sizeof(pages[npages].ch));
+                memset(pages[npages].g2, 0, sizeof(pages[npages].g2));
+                for (int k = 0; k < SCREEN_CELLS; k++) {
+                    pages[npages].attr[k] = ATTR_DEFAULT;
+                }
+                npages++;
+                row = 0;
+            }
+            if (word_tall && col == 0) {
+                row++;
+                line_tall = 1;
+            }
+            
+            // Rangée 0 réservée: la ligne de texte row va en rangée row + 1
+            if (space > 0) {
+                layout_put(&pages[npages - 1], row + 1, col, ' ', space_attr);
+                col += space;
+            }
+            for (int k = 0; k < word_len; k++) {
+                layout_put(&pages[npages - 1], row + 1, col, word[k], word_attr[k]);
+                col += (word_attr[k] & ATTR_DBL_WIDTH) ? 2 : 1;
+            }
+            word_len = 0;
+            word_width = 0;
+            word_tall = 0;
+            wrapped = 0;
+        }
+        
+        if (cp == '\n') {
+            // Pas de ligne vide en haut de page ni après une ligne pleine
+            if (row < SCREEN_ROWS && !wrapped) {
+                row++;
+            }
+            col = 0;
+            wrapped = 0;
+            line_tall = 0;
+            attr = ATTR_DEFAULT;  // les balises s'arrêtent en fin de ligne
+        } else if (col >= SCREEN_COLS) {
+            row++;
+            col = 0;
+            wrapped = 1;
+            line_tall = 0;
+        }
+        space_attr = attr;
+    }
+    
+    // Le bloc a doublé en grandissant: sa fin inutilisée retourne au système
+    if (arena != NULL && pages != NULL) {
+        pages = arena_grow(arena, pages, (size_t)npages * sizeof(screen_cells_t),
+                           (size_t)npages * sizeof(screen_cells_t));
+    }
+    *pages_out = pages;
+    return npages;
+}
+
+/**
+ * @brief Compile le texte pour le mode défilement: balises -> séquences ESC
+ * 
+ * Les sauts de ligne sont retirés (le retour à la ligne est fait à
+ * l'envoi). Les changements d'attributs ne sont émis qu'avant le
+ * prochain caractère visible, et seulement s'ils changent quelque chose:
+ * "{inv}{/inv}" ne coûte rien. Les caractères de commande du texte sont
+ * remplacés comme en mode page (tabulation: espace, autres: '?'): ils
+ * décaleraient le curseur ou la coupure des lignes.
+ * @return Flux pris dans l'arène (ou sur le tas, à libérer, si arena est
+ *         NULL), NULL en cas d'erreur
+ */
+uint8_t *compile_markup(arena_t *arena, const char *text, size_t len, size_t *out_len) {
+    // Pire cas: chaque octet visible précédé de tous les attributs
+    size_t cap = len * 2 + 16;
+    uint8_t *out = arena_alloc(arena, cap);
+    uint16_t want = ATTR_DEFAULT;
+    uint16_t cur = ATTR_DEFAULT;
+    size_t n = 0;
+    size_t i = 0;
+    
+    if (out == NULL) {
+        return NULL;
+    }
+    
+    while (i < len) {
+        uint8_t b = (uint8_t)text[i];
+        size_t plain = text_plain_span((const uint8_t *)text + i, len - i);
+        
+        // Texte ordinaire: attributs en attente, puis copie d'un bloc
+        if (plain > 0) {
+            if (want != cur) {
+                n += encode_attr_change(cur, want, out + n);
+                cur = want;
+            }
+            memcpy(out + n, text + i, plain);
+            n += plain;
+            i += plain;
+            continue;
+        }
+        
+        if (b == '{' && i + 1 < len && text[i + 1] == '{') {
+            i++;  // "{{": accolade littérale
+        } else if (b == '{') {
+            size_t tag = markup_tag(text + i, len - i, &want);
+            if (tag > 0) {
+                i += tag;
+                continue;
+            }
+        } else if (b == '\n') {
+            want = ATTR_DEFAULT;
+            i++;
+            continue;
+        } else if (b == '\r') {
+            i++;
+            continue;
+        } else if (b == '\t') {
+            b = ' ';
+        } else if (b < 0x20 || b == 0x7F) {
+            b = '?';
+        }
+        
+        // Pas d'attribut au milieu d'une séquence UTF-8
+        if ((b & 0xC0) != 0x80 && want != cur) {
+            n += encode_attr_change(cur, want, out + n);
+            cur = want;
+        }
+        
+        out[n++] = b;
+        i++;
+    }
+    
+    // L'arène reprend la marge du pire cas
+    if (arena != NULL) {
+        out = arena_grow(arena, out, cap, n);
+    }
+    *out_len = n;
+    return out;
+}
+
+/**
+ * @brief Lit un entier d'en-tête PNM (les commentaires # sont ignorés)
+ */
+static int pnm_read_int(FILE *file, int *value) {
+    int c;
+    
+    do {
+        c = fgetc(file);
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = fgetc(file);
+            }
+        }
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    
+    if (c < '0' || c > '9') {
+        return -1;
+    }
+    
+    *value = 0;
+    while (c >= '0' && c <= '9') {
+        *value = *value * 10 + (c - '0');
+        c = fgetc(file);
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Décode une image PGM/PPM (P2, P3, P5, P6) en niveaux de gris 8 bits
+ * @param filename Pour le journal seulement
+ * @return Pixels alloués (à libérer), NULL en cas d'erreur
+ */
+static uint8_t *pnm_decode(FILE *file, const char *filename, int *width, int *height) {
+    char magic[3] = { 0 };
+    int w, h, maxval;
+    int channels, binary;
+    uint8_t *pixels;
+    char msg[300];
+    
+    if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' ||
+        (magic[1] != '2' && magic[1] != '3' && magic[1] != '5' && magic[1] != '6') ||
+        pnm_read_int(file, &w) < 0 || pnm_read_int(file, &h) < 0 ||
+        pnm_read_int(file, &maxval) < 0 ||
+        w <= 0 || h <= 0 || w > 4096 || h > 4096 || maxval <= 0 || maxval > 65535) {
+        snprintf(msg, sizeof(msg), "%s: image PGM/PPM invalide", filename);
+        log_message("ERROR", msg);
+        return NULL;
+    }
+    
+    channels = (magic[1] == '3' || magic[1] == '6') ? 3 : 1;
+    binary = magic[1] >= '5';
+    
+    pixels = malloc((size_t)w * (size_t)h);
+    if (pixels == NULL) {
+        return NULL;
+    }
+    
+    for (int i = 0; i < w * h; i++) {
+        int rgb[3];
+        
+        for (int k = 0; k < channels; k++) {
+            if (!binary) {
+                if (pnm_read_int(file, &rgb[k]) < 0) {
+                    rgb[k] = 0;
+                }
+            } else if (maxval < 256) {
+                int c = fgetc(file);
+                rgb[k] = c == EOF ? 0 : c;
+            } else {
+                int hi = fgetc(file);
+                int lo = fgetc(file);
+                rgb[k] = (hi == EOF || lo == EOF) ? 0 : (hi << 8) | lo;
+            }
+        }
+        
+        int grey = channels == 3 ? (299 * rgb[0] + 587 * rgb[1] + 114 * rgb[2]) / 1000 : rgb[0];
+        pixels[i] = (uint8_t)((grey * 255 + maxval / 2) / maxval);
+    }
+    
+    *width = w;
+    *height = h;
+    return pixels;
+}
+
+/**
+ * @brief Charge une image PGM/PPM (P2, P3, P5, P6) en niveaux de gris 8 bits
+ * @return Pixels alloués (à libérer), NULL en cas d'erreur
+ */
+uint8_t *load_pnm_image(const char *filename, int *width, int *height) {
+    FILE *file = fopen(filename, "rb");
+    uint8_t *pixels;
+    char msg[300];
+    
+    if (file == NULL) {
+        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", filename, strerror(errno));
+        log_message("ERROR", msg);
+        return NULL;
+    }
+    
+    pixels = pnm_decode(file, filename, width, height);
+    fclose(file);
+    return pixels;
+}
+
+/**
+ * @brief Convertit une image en page semi-graphique G1 (cellules 2x3)
+ * 
+ * L'image est réduite en 80x72 pixels (proportions conservées), tramée
+ * par matrice de Bayer vers les 8 niveaux de gris du Minitel, puis chaque
+ * cellule reçoit le couple premier plan/fond et le motif 2x3 les plus
+ * proches. Le noyau travaille en tableaux par pixel de cellule
+ * (structure de tableaux) pour que le compilateur le vectorise. Ces
+ * tableaux (14 Ko) sont sur la pile: réentrante, la conversion peut
+ * tourner dans plusieurs fils à la fois.
+ */
+int mosaic_from_image(const uint8_t *pixels, int width, int height, screen_cells_t *frame) {
+    enum { MW = SCREEN_COLS * 2, MH = SCREEN_ROWS * 3, NCELLS = SCREEN_COLS * SCREEN_ROWS };
+    static const uint8_t bayer[3][2] = { { 0, 4 }, { 3, 1 }, { 5, 2 } };
+    // Niveau de gris (0 = noir .. 7 = blanc) -> couleur Minitel
+    static const uint8_t grey_to_colour[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+    uint8_t mosaic[MH][MW];
+    uint8_t lvl[6][NCELLS];
+    uint8_t fg[NCELLS], bg[NCELLS], bits[NCELLS];
+    int tw, th, ox, oy;
+    
+    // Réduction avec conservation des proportions, centrée sur fond noir
+    if (width * MH > height * MW) {
+        tw = MW;
+        th = height * MW / width;
+    } else {
+        th = MH;
+        tw = width * MH / height;
+    }
+    if (tw < 1) tw = 1;
+    if (th < 1) th = 1;
+    ox = (MW - tw) / 2;
+    oy = (MH - th) / 2;
+    
+    memset(mosaic, 0, sizeof(mosaic));
+    for (int y = 0; y < th; y++) {
+        int sy0 = y * height / th;
+        int sy1 = (y + 1) * height / th;
+        if (sy1 <= sy0) sy1 = sy0 + 1;
+        
+        for (int x = 0; x < tw; x++) {
+            int sx0 = x * width / tw;
+            int sx1 = (x + 1) * width / tw;
+            uint32_t sum = 0;
+            if (sx1 <= sx0) sx1 = sx0 + 1;
+            
+            for (int sy = sy0; sy < sy1; sy++) {
+                for (int sx = sx0; sx < sx1; sx++) {
+                    sum += pixels[sy * width + sx];
+                }
+            }
+            mosaic[oy + y][ox + x] = (uint8_t)(sum / (uint32_t)((sy1 - sy0) * (sx1 - sx0)));
+        }
+    }
+    
+    // Tramage ordonné vers 8 niveaux, rangé par position dans la cellule
+    for (int p = 0; p < 6; p++) {
+        int py = p / 2;
+        int px = p % 2;
+        int offset = (2 * bayer[py][px] + 1) * 255 / 12;  // seuil dans le pas
+        
+        for (int i = 0; i < NCELLS; i++) {
+            int v = mosaic[(i / SCREEN_COLS) * 3 + py][(i % SCREEN_COLS) * 2 + px];
+            int q = (v * 7 + offset) / 255;
+            lvl[p][i] = (uint8_t)(q > 7 ? 7 : q);
+        }
+    }
+    
+    // Noyau de correspondance: deux niveaux par cellule, motif au plus proche
+    for (int i = 0; i < NCELLS; i++) {
+        uint8_t lo = lvl[0][i], hi = lvl[0][i];
+        uint8_t b = 0;
+        
+        for (int p = 1; p < 6; p++) {
+            lo = lvl[p][i] < lo ? lvl[p][i] : lo;
+            hi = lvl[p][i] > hi ? lvl[p][i] : hi;
+        }
+        for (int p = 0; p < 6; p++) {
+            b |= (uint8_t)((2 * lvl[p][i] > lo + hi) << p);
+        }
+        
+        fg[i] = hi;
+        bg[i] = lo;
+        bits[i] = b;
+    }
+    
+    memset(frame->ch, ' ', sizeof(frame->ch));
+    memset(frame->g2, 0, sizeof(frame->g2));
+    for (int k = 0; k < SCREEN_CELLS; k++) {
+        frame->attr[k] = ATTR_DEFAULT;
+    }
+    
+    // Choix des couleurs limitant les changements d'attributs d'une cellule à l'autre
+    uint8_t prev_fg = 7, prev_bg = 0;
+    for (int i = 0; i < NCELLS; i++) {
+        uint8_t f = grey_to_colour[fg[i]];
+        uint8_t k = grey_to_colour[bg[i]];
+        uint8_t b = bits[i];
+        
+        if (i % SCREEN_COLS == 0) {
+            prev_fg = 7;  // US et début de rangée: attributs par défaut
+            prev_bg = 0;
+        }
+        
+        if (b == 0 || f == k) {
+            b = 0;
+            f = prev_fg;  // cellule unie: seul le fond compte
+        } else if (b == 0x3F) {
+            k = prev_bg;  // cellule pleine: seul le premier plan compte
+        } else if (f == prev_bg && k == prev_fg) {
+            uint8_t t = f;  // inverser le motif évite deux changements
+            f = k;
+            k = t;
+            b ^= 0x3F;
+        }
+        
+        prev_fg = f;
+        prev_bg = k;
+        
+        if (b == 0 && k == 0) {
+            frame->attr[SCREEN_COLS + i] = ATTR_DEFAULT;  // noir: cellule vide
+            continue;
+        }
+        
+        frame->ch[SCREEN_COLS + i] = (uint8_t)(0x20 | (b & 0x1F) | ((b & 0x20) << 1));
+        frame->attr[SCREEN_COLS + i] = (uint16_t)(ATTR_G1 | f | (k << ATTR_BG_SHIFT));
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Compare une cellule du modèle et une cellule cible
+ */
+static int cell_equal(const screen_cells_t *a, const screen_cells_t *b, int idx) {
+    return a->ch[idx] == b->ch[idx] && a->g2[idx] == b->g2[idx] && a->attr[idx] == b->attr[idx];
+}
+
+/**
+ * @brief Ajoute des octets au tampon en les appliquant à la simulation
+ */
+static void emit(minitel_screen_t *sim, uint8_t *out, size_t *n, const uint8_t *bytes, size_t len) {
+    memcpy(out + *n, bytes, len);
+    screen_feed(sim, bytes, len);
+    *n += len;
+}
+
+/**
+ * @brief Émet une cellule: changements d'attributs nécessaires puis glyphe
+ */
+static void emit_cell(minitel_screen_t *sim, const screen_cells_t *to, int idx, uint8_t *out, size_t *n) {
+    uint8_t seq[16];
+    size_t k = encode_attr_change(sim->cur_attr, to->attr[idx], seq);
+    uint8_t g2 = to->g2[idx];
+    
+    if (g2) {
+        seq[k++] = 0x19;  // SS2
+        seq[k++] = g2;
+    }
+    if (!g2 || (g2 >= 0x41 && g2 <= 0x4F)) {
+        seq[k++] = to->ch[idx];  // lettre de base après un accent
+    }
+    
+    emit(sim, out, n, seq, k);
+}
+
+/**
+ * @brief Encode les différences entre le modèle d'écran et une page cible
+ * 
+ * Seules les cellules modifiées des rangées 1 à 24 sont émises. Le
+ * positionnement US (3 octets) est remplacé par la réécriture des
+ * cellules intermédiaires lorsque c'est moins cher.
+ * @return Nombre d'octets écrits dans out (FRAME_MAX_BYTES au plus)
+ */
+size_t encode_frame_diff(const minitel_screen_t *from, const screen_cells_t *to, uint8_t *out) {
+    minitel_screen_t sim = *from;
+    size_t n = 0;
+    
+    for (int idx = SCREEN_COLS; idx < SCREEN_CELLS; idx++) {
+        int r = idx / SCREEN_COLS;
+        int c = idx % SCREEN_COLS;
+        int here = sim.row * SCREEN_COLS + sim.col;
+        
+        // Les cellules couvertes par un double format s'écrivent avec leur caractère
+        if (cell_equal(&sim.cells, to, idx) || (to->ch[idx] == 0 && to->g2[idx] == 0)) {
+            continue;
+        }
+        
+        if (here != idx) {
+            int plain = sim.row == r && sim.col < c && c - sim.col <= 2;
+            
+            // Les cellules avant idx sont déjà à jour: les réécrire telles quelles
+            for (int k = here; plain && k < idx; k++) {
+                plain = to->ch[k] != 0 && to->g2[k] == 0 && to->attr[k] == sim.cur_attr;
+            }
+            
+            if (plain) {
+                for (int k = here; k < idx; k++) {
+                    emit_cell(&sim, to, k, out, &n);
+                }
+            } else {
+                uint8_t us[3] = { 0x1F, (uint8_t)(0x40 + r), (uint8_t)(0x41 + c) };
+                emit(&sim, out, &n, us, 3);
+            }
+        }
+        
+        emit_cell(&sim, to, idx, out, &n);
+    }
+    
+    return n;
+}
+
+/**
+ * @brief Encode une page au moindre coût: différentiel ou effacement complet
+ */
+size_t encode_frame(const minitel_screen_t *from, const screen_cells_t *to, uint8_t *out) {
+    minitel_screen_t blank;
+    uint8_t full[FRAME_MAX_BYTES];
+    size_t len = encode_frame_diff(from, to, out);
+    size_t full_len;
+    
+    // Si la page diffère trop, effacer puis tout réécrire coûte moins cher
+    blank = *from;
+    screen_feed(&blank, (const uint8_t *)"\x0C", 1);
+    full[0] = 0x0C;
+    full_len = 1 + encode_frame_diff(&blank, to, full + 1);
+    
+    if (full_len < len) {
+        memcpy(out, full, full_len);
+        len = full_len;
+    }
+    
+    return len;
+}
+
+/**
+ * @brief Envoie un tampon déjà encodé, cadencé octet par octet
+ * 
+ * Les octets partent dans la file du fil d'écriture: la fonction rend la
+ * main dès qu'ils y sont, output_flush() attend qu'ils soient émis.
+ */
+int send_encoded(minitel_t *m, const uint8_t *buf, size_t len, int delay) {
+    if (output_queue(m, buf, len, delay) < 0) {
+        if (!m->reconnect && m->running) {
+            log_message("ERROR", "Erreur écriture page");
+        }
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Envoie une page en ne transmettant que les cellules modifiées
+ */
+int send_frame(minitel_t *m, const screen_cells_t *frame, int delay) {
+    uint8_t *buffer = m->engine->frame;
+    size_t len = encode_frame(&m->screen, frame, buffer);
+    
+    if (send_encoded(m, buffer, len, delay) < 0) {
+        return -1;
+    }
+    
+    return (int)len;
+}
+
+/**
+ * @brief Indique si le fichier est une image d'après son extension
+ */
+static int is_image_file(const char *path, int *is_png) {
+    const char *ext = strrchr(path, '.');
+    
+    *is_png = ext != NULL && strcasecmp(ext, ".png") == 0;
+    return ext != NULL && (strcasecmp(ext, ".pgm") == 0 || strcasecmp(ext, ".ppm") == 0 ||
+                           strcasecmp(ext, ".pnm") == 0 || *is_png);
+}
+
+/**
+ * @brief Libère les pages d'un contenu (toute son arène d'un coup)
+ */
+void content_free(content_t *content) {
+    if (content->cache_map != NULL) {
+        munmap(content->cache_map, content->cache_len);
+        content->cache_map = NULL;
+    }
+    arena_free(&content->arena);
+    content->pages = NULL;
+    content->stream = NULL;
+    content->stream_len = 0;
+    content->segments = NULL;
+    content->nsegments = 0;
+    content->npages = 0;
+    content->path[0] = '\0';
+}
+
+/**
+ * @brief Construit le passage du mode défilement d'un texte
+ * 
+ * Le flux compilé est découpé en lignes de cols caractères visibles
+ * (les séquences ESC ne comptent pas): segments cadencés désignant le
+ * flux, séparés par "\r\n", puis "\r" et skip sauts de ligne. Les retours
+ * à la ligne ne sont plus insérés à chaque passage; la liste reste en
+ * cache avec le contenu tant que cols et skip ne changent pas. Elle est
+ * prise en fin d'arène: une nouvelle liste remplace l'ancienne.
+ * @return 0, ou -1 si la mémoire manque
+ */
+int content_segments(content_t *content, int cols, int skip) {
+    static const uint8_t line_break[] = "\r\n";
+    static const uint8_t feeds[SEGMENT_FEEDS + 1] = "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
+    output_segment_t *segs;
+    size_t max;
+    size_t start = 0;
+    int visible = 0;
+    int escape = 0;
+    int n = 0;
+    
+    if (content->segments != NULL && content->segments_cols == cols && content->segments_skip == skip) {
+        return 0;
+    }
+    if (cols < 1) {
+        cols = 1;
+    }
+    
+    if (content->segments != NULL) {
+        arena_release(&content->arena, content->segments_mark);
+        content->segments = NULL;
+        content->nsegments = 0;
+    }
+    
+    // Deux segments par ligne au plus, plus la fin
+    max = 2 * (content->stream_len / (size_t)cols + 1) + 2 + (size_t)skip / SEGMENT_FEEDS + 1;
+    content->segments_mark = arena_mark(&content->arena);
+    segs = arena_alloc(&content->arena, max * sizeof(output_segment_t));
+    if (segs == NULL) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < content->stream_len; i++) {
+        // Les séquences ESC d'attributs n'occupent pas de place à l'écran
+        if (content->stream[i] == 0x1B || escape) {
+            escape = !escape;
+            continue;
+        }
+        if (++visible < cols) {
+            continue;
+        }
+        segs[n++] = (output_segment_t){ content->stream + start, (uint32_t)(i + 1 - start), SEGMENT_PACED };
+        segs[n++] = (output_segment_t){ line_break, 2, 0 };
+        start = i + 1;
+        visible = 0;
+    }
+    if (start < content->stream_len) {
+        segs[n++] = (output_segment_t){ content->stream + start, (uint32_t)(content->stream_len - start), SEGMENT_PACED };
+    }
+    
+    // Retour chariot, puis les lignes de fin
+    segs[n++] = (output_segment_t){ line_break, 1, 0 };
+    for (int left = skip; left > 0; left -= SEGMENT_FEEDS) {
+        segs[n++] = (output_segment_t){ feeds, (uint32_t)(left < SEGMENT_FEEDS ? left : SEGMENT_FEEDS), 0 };
+    }
+    content->segments = arena_grow(&content->arena, segs, max * sizeof(output_segment_t),
+                                   (size_t)n * sizeof(output_segment_t));
+    content->nsegments = n;
+    content->segments_cols = cols;
+    content->segments_skip = skip;
+    return 0;
+}
+
+/**
+ * @brief Charge une image PGM/PPM dans une page semi-graphique
+ * @param source Octets du fichier déjà lus (len octets), NULL pour lire path
+ */
+static int load_image_frame(const char *path, const char *source, size_t len, screen_cells_t *frame) {
+    struct timespec t0, t1;
+    uint8_t *pixels = NULL;
+    FILE *file;
+    int width, height;
+    int is_png;
+    char msg[400];
+    
+    is_image_file(path, &is_png);
+    if (is_png) {
+        snprintf(msg, sizeof(msg), "%s: PNG non supporté, convertir en PGM/PPM (ex: convert logo.png logo.ppm)", path);
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    if (source == NULL) {
+        pixels = load_pnm_image(path, &width, &height);
+    } else if ((file = fmemopen((void *)source, len, "rb")) != NULL) {
+        pixels = pnm_decode(file, path, &width, &height);
+        fclose(file);
+    }
+    if (pixels == NULL) {
+        return -1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    mosaic_from_image(pixels, width, height, frame);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(pixels);
+    
+    snprintf(msg, sizeof(msg), "Image %s (%dx%d) convertie en mosaïque en %.2f ms", path, width, height,
+             (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6);
+    log_message("INFO", msg);
+    return 0;
+}
+
+/**
+ * @brief Charge une image d'animation (image en mosaïque ou première page de texte)
+ */
+static int load_animation_frame(const char *path, screen_cells_t *frame) {
+    screen_cells_t *pages = NULL;
+    size_t len;
+    char *text;
+    int is_png;
+    int npages;
+    
+    if (is_image_file(path, &is_png)) {
+        return load_image_frame(path, NULL, 0, frame);
+    }
+    
+    text = load_text_file(path, &len);
+    if (text == NULL) {
+        return -1;
+    }
+    
+    npages = layout_pages(NULL, text, len, &pages);
+    free(text);
+    
+    if (npages <= 0) {
+        free(pages);
+        return -1;
+    }
+    
+    *frame = pages[0];
+    free(pages);
+    return 0;
+}
+
+/**
+ * @brief Charge une animation décrite par un fichier .anim
+ * 
+ * Format: une directive par ligne, les chemins sont relatifs au fichier.
+ *   # commentaire
+ *   fps 4
+ *   frame logo1.pgm
+ *   frame titre.txt
+ * @return Nombre d'images (tableau pris dans l'arène), -1 en cas d'erreur
+ */
+static int load_animation(arena_t *arena, const char *path, screen_cells_t **frames_out, int *fps) {
+    FILE *file;
+    char line[512];
+    char dir[256];
+    char frame_path[800];
+    screen_cells_t *frames = NULL;
+    int nframes = 0;
+    int line_no = 0;
+    char msg[900];
+    const char *slash;
+    
+    file = fopen(path, "r");
+    if (file == NULL) {
+        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", path, strerror(errno));
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    slash = strrchr(path, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path + 1) : 0, path);
+    *fps = 1;
+    
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *key = line;
+        char *value;
+        
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        while (*key == ' ' || *key == '\t') key++;
+        if (*key == '\0' || *key == '#') {
+            continue;
+        }
+        
+        value = key + strcspn(key, " \t");
+        if (*value != '\0') {
+            *value++ = '\0';
+            while (*value == ' ' || *value == '\t') value++;
+        }
+        
+        if (strcmp(key, "fps") == 0) {
+            *fps = atoi(value);
+            if (*fps < 1) *fps = 1;
+            if (*fps > ANIM_MAX_FPS) *fps = ANIM_MAX_FPS;
+        } else if (strcmp(key, "frame") == 0 && *value != '\0' && nframes < ANIM_MAX_FRAMES) {
+            screen_cells_t *grown = arena_grow(arena, frames, (size_t)nframes * sizeof(screen_cells_t),
+                                               (size_t)(nframes + 1) * sizeof(screen_cells_t));
+            if (grown == NULL) {
+                break;
+            }
+            frames = grown;
+            
+            if (value[0] == '/') {
+                snprintf(frame_path, sizeof(frame_path), "%s", value);
+            } else {
+                snprintf(frame_path, sizeof(frame_path), "%s%s", dir, value);
+            }
+            
+            if (load_animation_frame(frame_path, &frames[nframes]) == 0) {
+                nframes++;
+            } else {
+                // Rendre la place: la prochaine image agrandit encore le tableau sur place
+                frames = arena_grow(arena, frames, (size_t)(nframes + 1) * sizeof(screen_cells_t),
+                                    (size_t)nframes * sizeof(screen_cells_t));
+            }
+        } else {
+            snprintf(msg, sizeof(msg), "%s:%d: directive ignorée: %s", path, line_no, key);
+            log_message("WARN", msg);
+        }
+    }
+    
+    fclose(file);
+    *frames_out = frames;
+    return nframes;
+}
+
+/* Cache disque des contenus encodés: <dir>/<clé>.mtc */
+#define CACHE_MAGIC     "MTLCACHE"
+#define CACHE_FORMAT_VERSION 1      // à augmenter si la mise en page, la conversion en mosaïque ou l'entrée change
+#define CACHE_HEADER    64          // les pages commencent ici
+#define CACHE_MAX_ENTRIES 64        // au-delà, les moins récemment servies partent
+#define HASH_SEED       0xcbf29ce484222325ULL
+
+/**
+ * @brief En-tête d'une entrée du cache, suivi des pages puis du flux
+ */
+typedef struct {
+    char magic[8];
+    uint64_t key;
+    uint64_t checksum;      // pages et flux
+    uint64_t stream_len;
+    int32_t type;
+    int32_t npages;
+    int32_t fps;
+    int32_t has_stream;
+    int32_t version;        // CACHE_FORMAT_VERSION
+} cache_header_t;
+
+static char cache_dir[256] = CACHE_DIR;
+
+/**
+ * @brief Change le répertoire du cache des contenus ("" pour le couper)
+ */
+void content_cache_set_dir(const char *dir) {
+    snprintf(cache_dir, sizeof(cache_dir), "%s", dir);
+}
+
+/**
+ * @brief Empreinte FNV-1a 64 bits, à enchaîner depuis HASH_SEED
+ */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Clé d'un contenu: octets du fichier source et options d'encodage
+ * 
+ * Les octets sont ceux-là mêmes dont le contenu est construit: un fichier
+ * remplacé entre deux lectures ne peut pas ranger une version sous la
+ * clé d'une autre. Le type, la taille de l'écran et CACHE_FORMAT_VERSION
+ * entrent aussi dans la clé: une simple recompilation garde le cache, un
+ * encodeur modifié (version augmentée) ne reprend pas les anciennes entrées.
+ */
+static uint64_t cache_key(content_type_t type, const char *source, size_t len) {
+    const int32_t options[] = { (int32_t)type, SCREEN_COLS, SCREEN_ROWS, (int32_t)sizeof(screen_cells_t),
+                                CACHE_FORMAT_VERSION };
+    uint64_t h = hash_bytes(HASH_SEED, source, len);
+    
+    return hash_bytes(h, options, sizeof(options));
+}
+
+/**
+ * @brief Projette l'entrée key du cache dans content, si elle est intacte
+ * 
+ * Une entrée tronquée (coupure de courant) ou altérée est supprimée.
+ * @return 0 si le contenu est repris du cache, -1 sinon
+ */
+static int cache_fetch(content_t *content, uint64_t key, content_type_t type) {
+    char path[300];
+    char msg[400];
+    struct stat st;
+    const cache_header_t *h;
+    uint8_t *map;
+    size_t pages_len;
+    int fd;
+    
+    snprintf(path, sizeof(path), "%s/%016llx.mtc", cache_dir, (unsigned long long)key);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < CACHE_HEADER) {
+        close(fd);
+        goto invalid;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    futimens(fd, NULL);  // entrée servie: la dernière à partir
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    
+    h = (const cache_header_t *)map;
+    pages_len = h->npages >= 0 ? (size_t)h->npages * sizeof(screen_cells_t) : 0;
+    if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 || h->version != CACHE_FORMAT_VERSION ||
+        h->key != key || h->type != (int32_t)type ||
+        h->npages < 0 || h->npages > (int32_t)((size_t)st.st_size / sizeof(screen_cells_t)) ||
+        h->stream_len > (uint64_t)st.st_size ||
+        CACHE_HEADER + pages_len + h->stream_len != (uint64_t)st.st_size ||
+        hash_bytes(HASH_SEED, map + CACHE_HEADER, (size_t)st.st_size - CACHE_HEADER) != h->checksum) {
+        munmap(map, (size_t)st.st_size);
+        goto invalid;
+    }
+    
+    content->cache_map = map;
+    content->cache_len = (size_t)st.st_size;
+    content->pages = (screen_cells_t *)(map + CACHE_HEADER);
+    content->npages = h->npages;
+    content->stream = h->has_stream ? map + CACHE_HEADER + pages_len : NULL;
+    content->stream_len = h->stream_len;
+    content->fps = h->fps;
+    return 0;
+    
+invalid:
+    snprintf(msg, sizeof(msg), "Cache %s invalide, contenu recalculé", path);
+    log_message("WARN", msg);
+    unlink(path);
+    return -1;
+}
+
+/**
+ * @brief Garde les CACHE_MAX_ENTRIES entrées les plus récemment servies
+ */
+static int cache_entry_older(const void *a, const void *b) {
+    const struct stat *sa = a, *sb = b;
+    
+    return (sa->st_mtime > sb->st_mtime) - (sa->st_mtime < sb->st_mtime);
+}
+
+static void cache_prune(void) {
+    struct {
+        struct stat st;     // en tête: trié par cache_entry_older
+        char name[64];
+    } entries[CACHE_MAX_ENTRIES + 16];
+    char path[sizeof(cache_dir) + 1 + sizeof(entries[0].name)];
+    struct dirent *d;
+    size_t n = 0;
+    DIR *dir = opendir(cache_dir);
+    
+    if (dir == NULL) {
+        return;
+    }
+    while ((d = readdir(dir)) != NULL && n < sizeof(entries) / sizeof(entries[0])) {
+        size_t len = strlen(d->d_name);
+        
+        if (len < 5 || len >= sizeof(entries[0].name) || strcmp(d->d_name + len - 4, ".mtc") != 0) {
+            continue;
+        }
+        memcpy(entries[n].name, d->d_name, len + 1);
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[n].name);
+        if (stat(path, &entries[n].st) == 0) {
+            n++;
+        }
+    }
+    closedir(dir);
+    
+    if (n <= CACHE_MAX_ENTRIES) {
+        return;
+    }
+    qsort(entries, n, sizeof(entries[0]), cache_entry_older);
+    for (size_t i = 0; i < n - CACHE_MAX_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[i].name);
+        unlink(path);
+    }
+}
+
+/**
+ * @brief Enregistre un contenu encodé sous la clé key
+ * 
+ * Écrit à côté puis renommé: une entrée n'est jamais vue à moitié écrite.
+ * Sans fsync: une entrée perdue à la coupure échoue à la vérification et
+ * sera simplement recalculée.
+ */
+static void cache_store(const content_t *content, uint64_t key) {
+    uint8_t header[CACHE_HEADER] = { 0 };
+    cache_header_t *h = (cache_header_t *)header;
+    size_t pages_len = (size_t)content->npages * sizeof(screen_cells_t);
+    char tmp[300], path[300];
+    char msg[400];
+    struct iovec iov[3];
+    size_t total = sizeof(header) + pages_len + content->stream_len;
+    ssize_t n;
+    int written;
+    int err;
+    int fd;
+    
+    memcpy(h->magic, CACHE_MAGIC, sizeof(h->magic));
+    h->version = CACHE_FORMAT_VERSION;
+    h->key = key;
+    h->stream_len = content->stream_len;
+    h->type = (int32_t)content->type;
+    h->npages = content->npages;
+    h->fps = content->fps;
+    h->has_stream = content->stream != NULL;
+    h->checksum = hash_bytes(hash_bytes(HASH_SEED, content->pages, pages_len), content->stream, content->stream_len);
+    
+    snprintf(path, sizeof(path), "%s/%016llx.mtc", cache_dir, (unsigned long long)key);
+    snprintf(tmp, sizeof(tmp), "%s/.%016llx.XXXXXX", cache_dir, (unsigned long long)key);
+    fd = mkostemp(tmp, O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && mkdir(cache_dir, 0755) == 0) {
+        snprintf(tmp, sizeof(tmp), "%s/.%016llx.XXXXXX", cache_dir, (unsigned long long)key);
+        fd = mkostemp(tmp, O_CLOEXEC);
+    }
+    if (fd < 0) {
+        snprintf(msg, sizeof(msg), "Cache %s: écriture impossible: %s", cache_dir, strerror(errno));
+        log_message("WARN", msg);
+        return;
+    }
+    
+    iov[0] = (struct iovec){ header, sizeof(header) };
+    iov[1] = (struct iovec){ content->pages, pages_len };
+    iov[2] = (struct iovec){ content->stream, content->stream_len };
+    n = writev(fd, iov, 3);
+    written = n == (ssize_t)total;
+    err = n < 0 ? errno : ENOSPC;  // écriture partielle: disque plein
+    if (close(fd) < 0 && written) {
+        written = 0;
+        err = errno;
+    }
+    if (written && rename(tmp, path) < 0) {
+        written = 0;
+        err = errno;
+    }
+    if (!written) {
+        snprintf(msg, sizeof(msg), "Cache %s: écriture impossible: %s", path, strerror(err));
+        log_message("WARN", msg);
+        unlink(tmp);
+        return;
+    }
+    cache_prune();
+}
+
+/**
+ * @brief Charge un contenu (texte mis en page, image en mosaïque ou animation)
+ * 
+ * Le résultat est gardé en cache: tant que le fichier n'a changé ni de
+ * date (à la nanoseconde), ni de taille, ni d'inode (remplacé par
+ * rename()), les pages déjà calculées sont réutilisées. Pour une
+ * animation, c'est le fichier .anim qui fait foi. La nouvelle version est
+ * construite dans sa propre arène; l'ancienne est rendue d'un coup une
+ * fois la nouvelle prête.
+ * 
+ * Textes et images encodés sont aussi gardés sur disque (cache_dir),
+ * sous l'empreinte du fichier source: après un redémarrage, ils sont
+ * projetés tels quels, sans mise en page ni conversion. Les animations,
+ * faites de plusieurs fichiers, sont toujours recalculées.
+ * @return 0 si les pages sont disponibles, -1 sinon
+ */
+int content_load(content_t *content, const char *path) {
+    arena_t arena = { 0 };
+    content_t cached = { 0 };
+    uint64_t key = 0;
+    int keyed;
+    char *source = NULL;
+    size_t source_len = 0;
+    struct stat st;
+    screen_cells_t *pages = NULL;
+    uint8_t *stream = NULL;
+    size_t stream_len = 0;
+    int npages;
+    int fps = 0;
+    int is_png;
+    const char *ext = strrchr(path, '.');
+    content_type_t type;
+    char msg[400];
+    
+    if (stat(path, &st) < 0) {
+        snprintf(msg, sizeof(msg), "Erreur accès %s: %s", path, strerror(errno));
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    if (content->pages != NULL && strcmp(content->path, path) == 0 && content->ino == st.st_ino &&
+        content->mtime.tv_sec == st.st_mtim.tv_sec && content->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+        content->size == st.st_size) {
+        return 0;
+    }
+    
+    type = ext != NULL && strcasecmp(ext, ".anim") == 0 ? CONTENT_ANIMATION
+         : is_image_file(path, &is_png) ? CONTENT_IMAGE : CONTENT_TEXT;
+    
+    // Texte ou image: une seule lecture, pour la clé du cache comme pour l'encodage
+    if (type != CONTENT_ANIMATION) {
+        source = read_file(path, &source_len);
+        if (source == NULL) {
+            return -1;
+        }
+    }
+    
+    // Déjà encodé lors d'un démarrage précédent: projeté depuis le cache
+    keyed = source != NULL && cache_dir[0] != '\0';
+    if (keyed) {
+        key = cache_key(type, source, source_len);
+    }
+    if (keyed && cache_fetch(&cached, key, type) == 0) {
+        pages = cached.pages;
+        npages = cached.npages;
+        stream = cached.stream;
+        stream_len = cached.stream_len;
+        fps = cached.fps;
+    } else if (type == CONTENT_ANIMATION) {
+        npages = load_animation(&arena, path, &pages, &fps);
+        if (npages <= 0) {
+            arena_free(&arena);
+            snprintf(msg, sizeof(msg), "%s: aucune image d'animation", path);
+            log_message("ERROR", msg);
+            return -1;
+        }
+    } else if (type == CONTENT_IMAGE) {
+        pages = arena_alloc(&arena, sizeof(screen_cells_t));
+        if (pages == NULL || load_image_frame(path, source, source_len, pages) < 0) {
+            arena_free(&arena);
+            free(source);
+            return -1;
+        }
+        npages = 1;
+    } else {
+        text_sanitize(source, source_len, path);
+        npages = layout_pages(&arena, source, source_len, &pages);
+        stream = compile_markup(&arena, source, source_len, &stream_len);
+        
+        if (npages < 0 || stream == NULL) {
+            arena_free(&arena);
+            free(source);
+            log_message("ERROR", "Mémoire insuffisante pour la mise en page");
+            return -1;
+        }
+    }
+    free(source);
+    
+    content_free(content);  // pages, flux et segments de l'ancienne version
+    content->arena = arena;
+    content->cache_map = cached.cache_map;
+    content->cache_len = cached.cache_len;
+    content->type = type;
+    content->pages = pages;
+    content->stream = stream;
+    content->stream_len = stream_len;
+    content->segments = NULL;
+    content->nsegments = 0;
+    content->npages = npages;
+    content->fps = fps;
+    content->mtime = st.st_mtim;
+    content->ino = st.st_ino;
+    content->size = st.st_size;
+    snprintf(content->path, sizeof(content->path), "%s", path);
+    
+    if (cached.cache_map != NULL) {
+        snprintf(msg, sizeof(msg), "Contenu %s repris du cache: %d page(s), %zu Ko", path, npages,
+                 (cached.cache_len + 1023) / 1024);
+        log_message("INFO", msg);
+        return 0;
+    }
+    if (keyed) {
+        cache_store(content, key);
+    }
+    
+    snprintf(msg, sizeof(msg), "Contenu %s chargé: %d page(s), %zu Ko", path, npages,
+             (arena.used + 1023) / 1024);
+    log_message("INFO", msg);
+    return 0;
+}
+
+/**
+ * @brief Joue une animation en n'envoyant que les différences entre images
+ * 
+ * L'image affichée est toujours la plus récente dont l'heure est venue:
+ * quand l'envoi d'un delta dépasse le budget de la ligne (vitesse du terminal), les
+ * images en retard sont sautées et leurs changements fusionnés dans le
+ * delta suivant, calculé contre ce que le Minitel affiche réellement.
+ */
+int play_animation(minitel_t *m, const content_t *anim, int delay) {
+    uint8_t *buffer = m->engine->frame;
+    struct timespec start, now, next;
+    long interval_ns = 1000000000L / anim->fps;
+    long line_us = 10000000L / m->terminal.speed;  // 10 bits par caractère
+    long byte_us = delay > line_us ? delay : line_us;
+    int shown = -1;
+    int sent_frames = 0;
+    int dropped = 0;
+    int over_budget = 0;
+    size_t total = 0;
+    char msg[256];
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    while (m->running && !m->reconnect) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long elapsed = (long long)(now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec);
+        int due = (int)(elapsed / interval_ns);
+        
+        if (due >= anim->npages) {
+            break;
+        }
+        
+        if (due > shown) {
+            size_t len = encode_frame(&m->screen, &anim->pages[due], buffer);
+            
+            if (shown >= 0) {
+                dropped += due - shown - 1;
+                metric_add(&m->metrics.frames_dropped, (uint64_t)(due - shown - 1));
+            }
+            if (!over_budget && (long)len * byte_us > interval_ns / 1000) {
+                // Une fois par lecture: les suivantes se voient dans frames_dropped
+                snprintf(msg, sizeof(msg), "Animation: image %d (%zu octets) hors budget (%ld µs/image), images sautées",
+                         due, len, interval_ns / 1000);
+                log_message("WARN", msg);
+                over_budget = 1;
+            }
+            
+            // Attendre l'émission: l'image suivante se choisit sur l'heure réelle
+            if (send_encoded(m, buffer, len, delay) < 0 || output_flush(m) < 0) {
+                return m->reconnect ? -1 : 0;
+            }
+            
+            total += len;
+            shown = due;
+            sent_frames++;
+        }
+        
+        // Prochaine échéance: l'image suivante
+        long long target = (long long)(shown + 1) * interval_ns;
+        next.tv_sec = start.tv_sec + (time_t)((start.tv_nsec + target) / 1000000000LL);
+        next.tv_nsec = (long)((start.tv_nsec + target) % 1000000000LL);
+        event_wait_until(m, &next, 0);
+    }
+    
+    snprintf(msg, sizeof(msg), "Animation: %d image(s) envoyée(s), %d sautée(s), %zu octets",
+             sent_frames, dropped, total);
+    log_message("INFO", msg);
+    return 0;
+}
+
+/**
+ * @brief Affiche une image ou joue une animation, puis la laisse hold secondes
+ */
+int show_interlude(minitel_t *m, content_t *interlude, const char *path, int delay, int hold) {
+    char msg[300];
+    int sent;
+    
+    if (content_load(interlude, path) < 0 || interlude->npages == 0) {
+        return 0;  // intermède absent: on continue avec le texte
+    }
+    
+    if (interlude->type == CONTENT_ANIMATION) {
+        if (play_animation(m, interlude, delay) < 0) {
+            return -1;
+        }
+    } else {
+        sent = send_frame(m, &interlude->pages[0], delay);
+        if (sent < 0) {
+            return -1;
+        }
+        
+        snprintf(msg, sizeof(msg), "Image envoyée: %d octets", sent);
+        log_message("INFO", msg);
+    }
+    
+    // La durée d'affichage court une fois l'image entièrement dessinée
+    if (output_flush(m) < 0) {
+        return 0;
+    }
+    event_wait(m, (long)hold * 1000000L, 0);
+    key_flush(m);
+    return 0;
+}
+
+/**
+ * @brief Lit une réponse du Minitel avec délai maximal
+ * @param first Premier octet attendu (les octets précédents sont ignorés)
+ * @param last Octet de fin (0: s'arrêter après max octets)
+ * @return Nombre d'octets lus à partir de first
+ */
+static size_t read_reply(int fd, uint8_t first, uint8_t last, uint8_t *buf, size_t max, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    size_t n = 0;
+    
+    while (n < max && poll(&pfd, 1, timeout_ms) > 0) {
+        uint8_t b;
+        
+        if (read(fd, &b, 1) != 1) {
+            break;
+        }
+        b &= 0x7F;
+        
+        if (n == 0 && b != first) {
+            continue;  // touche ou bruit avant la réponse
+        }
+        buf[n++] = b;
+        
+        if (last != 0 && b == last) {
+            break;
+        }
+    }
+    
+    return n;
+}
+
+/**
+ * @brief Vitesse correspondant à un octet de programmation PRO2 PROG / STATUS
+ */
+static int speed_from_code(uint8_t code) {
+    switch ((code >> 3) & 0x07) {
+        case 2: return 1200;
+        case 4: return 4800;
+        case 6: return 9600;
+        case 7: return 19200;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Constante termios d'une vitesse
+ */
+static speed_t speed_to_baud(int speed) {
+    switch (speed) {
+        case 1200: return B1200;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        default: return B4800;
+    }
+}
+
+/**
+ * @brief Passe le Minitel et le port à une autre vitesse (PRO2 PROG)
+ * @return 0 si le Minitel confirme la nouvelle vitesse
+ */
+static int switch_terminal_speed(minitel_t *m, int speed) {
+    int fd = m->fd;
+    struct termios options;
+    uint8_t code = (uint8_t)(0x40 | (speed == 9600 ? 0x36 : speed == 19200 ? 0x3F : speed == 1200 ? 0x12 : 0x24));
+    uint8_t prog[4] = { 0x1B, 0x3A, 0x6B, code };
+    uint8_t reply[4];
+    speed_t old_speed;
+    
+    if (tcgetattr(fd, &options) < 0) {
+        return -1;
+    }
+    old_speed = cfgetospeed(&options);
+    
+    if (serial_write(m, prog, sizeof(prog)) != (ssize_t)sizeof(prog) || output_drain(m, PROBE_TIMEOUT_MS) < 0) {
+        return -1;
+    }
+    
+    // Le Minitel répond PRO2 STATUS à la nouvelle vitesse
+    cfsetispeed(&options, speed_to_baud(speed));
+    cfsetospeed(&options, speed_to_baud(speed));
+    tcsetattr(fd, TCSANOW, &options);
+    
+    if (read_reply(fd, 0x1B, 0, reply, 4, PROBE_TIMEOUT_MS) == 4 && reply[2] == 0x75 &&
+        speed_from_code(reply[3]) == speed) {
+        return 0;
+    }
+    
+    cfsetispeed(&options, old_speed);
+    cfsetospeed(&options, old_speed);
+    tcsetattr(fd, TCSANOW, &options);
+    return -1;
+}
+
+/**
+ * @brief Identifie le Minitel connecté (PRO1 ENQROM + STATUS VITESSE)
+ * 
+ * Le résultat est gardé par port: une reconnexion ne relance pas la
+ * sonde. Sans réponse (ESP32 pas prêt, autre terminal), les réglages
+ * par défaut sont conservés et la sonde sera retentée.
+ * @param switch_speed Passer à la vitesse maximale du modèle
+ * @return 0 si le terminal a répondu
+ */
+int probe_terminal(minitel_t *m, const char *port, int switch_speed) {
+    static const uint8_t enqrom[3] = { 0x1B, 0x39, 0x7B };
+    static const uint8_t status_speed[3] = { 0x1B, 0x39, 0x74 };
+    terminal_caps_t *caps = &m->terminal;
+    int fd = m->fd;
+    uint8_t reply[8];
+    char msg[256];
+    size_t n;
+    
+    for (int i = 0; i < PROBE_CACHE_SIZE; i++) {
+        if (probe_cache[i].probed && strcmp(probe_cache[i].port, port) == 0) {
+            *caps = probe_cache[i];
+            snprintf(msg, sizeof(msg), "Terminal (cache): %s, %d bauds", caps->model, caps->speed);
+            log_message("INFO", msg);
+            return 0;
+        }
+    }
+    
+    memset(caps, 0, sizeof(*caps));
+    snprintf(caps->port, sizeof(caps->port), "%s", port);
+    caps->model = "inconnu";
+    caps->speed = DEFAULT_SPEED;
+    caps->max_speed = DEFAULT_SPEED;
+    
+    tcflush(fd, TCIFLUSH);
+    if (serial_write(m, enqrom, sizeof(enqrom)) != (ssize_t)sizeof(enqrom)) {
+        return -1;
+    }
+    
+    // Réponse: SOH, constructeur, modèle, version, EOT
+    n = read_reply(fd, 0x01, 0x04, reply, 5, PROBE_TIMEOUT_MS);
+    if (n != 5 || reply[4] != 0x04) {
+        log_message("WARN", "Pas de réponse à l'identification, réglages par défaut");
+        return -1;
+    }
+    
+    caps->probed = 1;
+    memcpy(caps->rom, reply + 1, 3);
+    for (size_t i = 0; i < sizeof(minitel_models) / sizeof(minitel_models[0]); i++) {
+        if (minitel_models[i].code == caps->rom[1]) {
+            caps->model = minitel_models[i].name;
+            caps->max_speed = minitel_models[i].max_speed;
+            caps->cols80 = minitel_models[i].cols80;
+            caps->drcs = minitel_models[i].drcs;
+            break;
+        }
+    }
+    
+    // Vitesse actuelle: PRO2 STATUS (ESC 0x3A 0x75 + code)
+    if (serial_write(m, status_speed, sizeof(status_speed)) == (ssize_t)sizeof(status_speed) &&
+        read_reply(fd, 0x1B, 0, reply, 4, PROBE_TIMEOUT_MS) == 4 && reply[2] == 0x75 &&
+        speed_from_code(reply[3]) > 0) {
+        caps->speed = speed_from_code(reply[3]);
+    }
+    
+    if (switch_speed && caps->max_speed > caps->speed) {
+        if (switch_terminal_speed(m, caps->max_speed) == 0) {
+            caps->speed = caps->max_speed;
+        } else {
+            log_message("WARN", "Changement de vitesse refusé, vitesse conservée");
+        }
+    }
+    
+    snprintf(msg, sizeof(msg), "Terminal: %s (ROM %c%c%c), %d bauds (max %d), 80 colonnes: %s, DRCS: %s",
+             caps->model, caps->rom[0], caps->rom[1], caps->rom[2], caps->speed, caps->max_speed,
+             caps->cols80 ? "oui" : "non", caps->drcs ? "oui" : "non");
+    log_message("INFO", msg);
+    
+    // Mémoriser pour les reconnexions
+    for (int i = 0; i < PROBE_CACHE_SIZE; i++) {
+        if (!probe_cache[i].probed || strcmp(probe_cache[i].port, port) == 0) {
+            probe_cache[i] = *caps;
+            break;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Délai calibré pour ce port et cette vitesse
+ * @return délai en µs, ou -1 si pas de calibrage enregistré
+ */
+int calibration_load(const char *path, const char *port, int speed) {
+    FILE *file = fopen(path, "r");
+    char line[256];
+    char line_port[200];
+    int line_speed, line_delay;
+    int delay = -1;
+    
+    if (file == NULL) {
+        return -1;
+    }
+    
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%199s %d %d", line_port, &line_speed, &line_delay) == 3 &&
+            strcmp(line_port, port) == 0 && line_speed == speed && line_delay > 0) {
+            delay = line_delay;
+        }
+    }
+    
+    fclose(file);
+    return delay;
+}
+
+/**
+ * @brief Enregistre le délai calibré d'un port (remplace l'ancienne valeur)
+ */
+int calibration_save(const char *path, const char *port, int speed, int delay) {
+    char tmp_path[512];
+    char line[256];
+    char line_port[200];
+    FILE *in = fopen(path, "r");
+    FILE *out;
+    
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        if (in != NULL) {
+            fclose(in);
+        }
+        return -1;
+    }
+    
+    fprintf(out, "# port vitesse délai_µs (minitel -C)\n");
+    if (in != NULL) {
+        while (fgets(line, sizeof(line), in) != NULL) {
+            if (line[0] == '#' || (sscanf(line, "%199s", line_port) == 1 && strcmp(line_port, port) == 0)) {
+                continue;
+            }
+            fputs(line, out);
+        }
+        fclose(in);
+    }
+    fprintf(out, "%s %d %d\n", port, speed, delay);
+    
+    if (fclose(out) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return rename(tmp_path, path);
+}
+
+/**
+ * @brief Un palier de calibrage: CALIB_BYTES octets à delay µs par octet
+ * 
+ * Le palier part en une rafale cadencée par le fil d'écriture, comme un
+ * passage. Le débit est tenu si aucune écriture n'échoue, si la file de
+ * sortie du pilote ne grossit pas, si write() ne bloque pas (contrôle de
+ * flux de l'ESP32: plus de 1 % des écritures plus longues qu'un créneau,
+ * d'après l'histogramme write_latency du fil d'écriture) et si le
+ * cadencement suit (dérive et dépassements sous 5 %).
+ * @return 1 si tenu, 0 sinon, -1 si arrêt ou port perdu
+ */
+static int calibrate_step(minitel_t *m, long delay, char *verdict, size_t verdict_len) {
+    static const char pattern[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-+";
+    struct minitel_engine *e = m->engine;
+    histogram_t *latency = &m->metrics.write_latency;
+    uint64_t errors = atomic_load_explicit(&m->metrics.write_errors, memory_order_relaxed);
+    uint64_t counts[HIST_BUCKETS];
+    uint8_t bytes[CALIB_BYTES];
+    uint64_t slow_writes = 0;
+    uint64_t max_write = 0;
+    int queued = 0;
+    int max_queue = 0;
+    
+    if (output_drain(m, OUTPUT_STALL_US / 1000) < 0) {
+        return -1;
+    }
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        counts[b] = atomic_load_explicit(&latency->counts[b], memory_order_relaxed);
+    }
+    for (int i = 0; i < CALIB_BYTES; i++) {
+        bytes[i] = (uint8_t)pattern[i % (sizeof(pattern) - 1)];
+    }
+    
+    if (output_queue(m, bytes, CALIB_BYTES, delay) < 0) {
+        return -1;
+    }
+    
+    // File du pilote relevée à chaque ligne, pendant que le fil d'écriture émet
+    while (output_pending(e) > 0 || !atomic_load(&e->writer_idle)) {
+        if (event_wait(m, SCREEN_COLS * delay, 0) < 0 || m->reconnect) {
+            return -1;
+        }
+        if (ioctl(m->fd, TIOCOUTQ, &queued) == 0 && queued > max_queue) {
+            max_queue = queued;
+        }
+    }
+    if (atomic_load(&e->output_discard) || ioctl(m->fd, TIOCOUTQ, &queued) < 0) {
+        queued = 0;
+    }
+    
+    // Écritures du palier: différence des seaux (max à ±12,5 %)
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        uint64_t n = atomic_load_explicit(&latency->counts[b], memory_order_relaxed) - counts[b];
+        
+        if (n > 0 && hist_bucket_low(b) > (uint64_t)delay) {
+            slow_writes += n;
+        }
+        if (n > 0) {
+            max_write = hist_bucket_low(b);
+        }
+    }
+    
+    double drift = (double)atomic_load_explicit(&m->metrics.pacing_drift_ppm, memory_order_relaxed) / 1e6;
+    
+    if (atomic_load_explicit(&m->metrics.write_errors, memory_order_relaxed) != errors) {
+        snprintf(verdict, verdict_len, "erreurs d'écriture");
+    } else if (queued > CALIB_QUEUE_SLACK) {
+        snprintf(verdict, verdict_len, "la file de sortie grossit (%d octets, max %d)", queued, max_queue);
+    } else if (slow_writes > CALIB_BYTES / 100) {
+        snprintf(verdict, verdict_len, "write() bloque (%llu fois, max %llu µs)",
+                 (unsigned long long)slow_writes, (unsigned long long)max_write);
+    } else if (drift > 0.05 || e->writer_burst.overruns > CALIB_BYTES / 20) {
+        snprintf(verdict, verdict_len, "cadencement non tenu (dérive %+.1f %%, %lu dépassements)",
+                 drift * 100.0, e->writer_burst.overruns);
+    } else {
+        snprintf(verdict, verdict_len, "tenu (dérive %+.1f %%, file max %d octets)", drift * 100.0, max_queue);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Cherche le plus petit délai par octet que le port tient
+ * 
+ * Essaie des délais croissants à partir du temps d'un caractère à la
+ * vitesse du terminal (10 bits): le Minitel n'affiche pas plus vite que
+ * sa ligne, même si le lien USB ou l'ESP32 en amont le permettrait.
+ * @return délai retenu en µs (marge CALIB_MARGIN_PCT comprise), -1 sinon
+ */
+int calibrate_port(minitel_t *m) {
+    static const int factors[] = { 100, 110, 125, 150, 200, 300, 400 };  // % du temps ligne
+    int speed = m->terminal.speed;
+    long line_us = 10000000L / speed;
+    char verdict[160];
+    char msg[300];
+    
+    for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); i++) {
+        long delay = line_us * factors[i] / 100;
+        int len = snprintf(msg, sizeof(msg), "\r\nCalibrage %d bauds: %ld us/octet\r\n", speed, delay);
+        
+        if (serial_write(m, msg, (size_t)len) < 0) {
+            return -1;
+        }
+        int r = calibrate_step(m, delay, verdict, sizeof(verdict));
+        if (r < 0) {
+            return -1;
+        }
+        
+        snprintf(msg, sizeof(msg), "Calibrage %ld µs/octet (%ld octets/s): %s", delay, 1000000L / delay, verdict);
+        log_message("INFO", msg);
+        
+        if (r == 1) {
+            return (int)(delay * (100 + CALIB_MARGIN_PCT) / 100);
+        }
+    }
+    
+    log_message("WARN", "Calibrage: aucun débit tenu");
+    return -1;
+}
+
+/**
+ * @brief Envoie le fichier au Minitel avec gestion d'erreurs
+ * 
+ * Le texte compilé (balises converties en séquences ESC) vient du cache
+ * de contenu: il n'est recompilé que si le fichier a changé.
+ */
+int send_file_to_minitel(minitel_t *m, content_t *content, const char *filename, int delay) {
+    uint64_t bytes_sent = 0;
+    int fd = m->fd;
+    char msg[256];
+    
+    if (fd < 0 || !check_serial_connection(fd)) {
+        log_message("ERROR", "Port série non connecté");
+        return -1;
+    }
+    
+    if (content_load(content, filename) < 0) {
+        return -1;
+    }
+    
+    if (content->stream == NULL) {
+        snprintf(msg, sizeof(msg), "%s n'est pas un texte, utiliser le mode page (-P)", filename);
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    snprintf(msg, sizeof(msg), "Lecture de %s (%ld octets)", filename, (long)content->size);
+    log_message("INFO", msg);
+    
+    if (content->stream_len == 0) {
+        log_message("WARN", "Fichier vide !");
+        return 0;  // Pas une erreur, juste vide
+    }
+    
+    if (content_segments(content, m->chars_per_line, m->lines_skip) < 0) {
+        log_message("ERROR", "Mémoire insuffisante pour le passage");
+        return -1;
+    }
+    
+    // Rejouer le passage pré-encodé: le fil d'écriture l'envoie depuis le
+    // flux en cache, ce fil sert la boucle d'événements pendant ce temps
+    if (output_replay(m, content->segments, content->nsegments, delay, &bytes_sent) < 0) {
+        snprintf(msg, sizeof(msg), "Connexion perdue pendant l'envoi (%llu octets envoyés)",
+                 (unsigned long long)bytes_sent);
+        log_message("ERROR", msg);
+        return -1;
+    }
+    
+    if (!m->running || m->interrupt) {
+        return 0;  // arrêt demandé ou fermeture: la file est abandonnée ou vidée par l'appelant
+    }
+    
+    // Attendre la fin de l'émission; le clavier est lu pendant l'attente (touches ignorées ici)
+    if (output_flush(m) < 0) {
+        return m->reconnect ? -1 : 0;
+    }
+    key_flush(m);
+    pacer_report(&m->engine->writer_burst, "du texte");
+    
+    snprintf(msg, sizeof(msg), "Fichier envoyé: %llu octets", (unsigned long long)bytes_sent);
+    log_message("INFO", msg);
+    
+    if (bytes_sent == 0) {
+        log_message("WARN", "Aucun octet envoyé ! Fichier vide ou que des retours ligne ?");
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Pré-encode une page à partir de l'écran actuel
+ */
+static void prepare_frame(minitel_t *m, prepared_frame_t *prep, const content_t *content, int page) {
+    if (page < 0 || page >= content->npages) {
+        prep->page = -1;
+        return;
+    }
+    
+    prep->len = encode_frame(&m->screen, &content->pages[page], prep->bytes);
+    prep->page = page;
+    prep->stamp = m->screen.bytes;
+}
+
+/**
+ * @brief Affiche une page, en utilisant la version pré-encodée si elle est encore valable
+ */
+static int show_page(minitel_t *m, const content_t *content, int page, int delay) {
+    struct minitel_engine *e = m->engine;
+    
+    for (int k = 0; k < 2; k++) {
+        // Valable seulement si rien n'a été envoyé depuis l'encodage
+        if (e->prepared[k].page == page && e->prepared[k].stamp == m->screen.bytes) {
+            e->prepared[k].page = -1;
+            if (send_encoded(m, e->prepared[k].bytes, e->prepared[k].len, delay) < 0) {
+                return -1;
+            }
+            return (int)e->prepared[k].len;
+        }
+    }
+    
+    return send_frame(m, &content->pages[page], delay);
+}
+
+/**
+ * @brief Écrit une chaîne ASCII dans une page
+ */
+static void put_text(screen_cells_t *page, int row, int col, const char *text, uint16_t attr) {
+    for (; *text != '\0' && col < SCREEN_COLS; text++) {
+        layout_put(page, row, col, videotex_glyph((unsigned char)*text), attr);
+        col += (attr & ATTR_DBL_WIDTH) ? 2 : 1;
+    }
+}
+
+/**
+ * @brief Construit la page de sommaire
+ * 
+ * Les entrées sont les titres du texte (lignes en double hauteur, voir
+ * {dbl} et {dh}). Sans titre, chaque page est une entrée, présentée par
+ * sa première ligne.
+ * @return Nombre d'entrées (numéros de page dans targets)
+ */
+int build_index_page(const content_t *content, const char *choice, screen_cells_t *index, int *targets) {
+    int nentries = 0;
+    char line[48];
+    
+    memset(index->ch, ' ', sizeof(index->ch));
+    memset(index->g2, 0, sizeof(index->g2));
+    for (int k = 0; k < SCREEN_CELLS; k++) {
+        index->attr[k] = ATTR_DEFAULT;
+    }
+    put_text(index, 2, 0, "SOMMAIRE", ATTR_DEFAULT | ATTR_DBL_HEIGHT | ATTR_DBL_WIDTH);
+    
+    for (int pass = 0; pass < 2 && nentries == 0; pass++) {
+        for (int p = 0; p < content->npages && nentries < INDEX_MAX_ENTRIES; p++) {
+            const screen_cells_t *page = &content->pages[p];
+            
+            for (int r = 1; r <= SCREEN_ROWS; r++) {
+                int first = r * SCREEN_COLS;
+                int row = 4 + nentries;
+                int col = 4;
+                
+                // 1er passage: titres en double hauteur; 2e: première ligne non vide
+                if (pass == 0 ? !(page->attr[first] & ATTR_DBL_HEIGHT) || page->ch[first] == 0
+                              : page->ch[first] == ' ' && page->g2[first] == 0) {
+                    continue;
+                }
+                
+                snprintf(line, sizeof(line), "%2d", nentries + 1);
+                put_text(index, row, 0, line, ATTR_DEFAULT | ATTR_INVERSE);
+                
+                for (int c = 0; c < SCREEN_COLS && col < SCREEN_COLS - 5; c++) {
+                    if (page->ch[first + c] == 0 && page->g2[first + c] == 0) {
+                        continue;  // cellule couverte par un double format
+                    }
+                    index->ch[row * SCREEN_COLS + col] = page->ch[first + c];
+                    index->g2[row * SCREEN_COLS + col] = page->g2[first + c];
+                    col++;
+                }
+                
+                snprintf(line, sizeof(line), "p%d", p + 1);
+                put_text(index, row, SCREEN_COLS - (int)strlen(line), line, ATTR_DEFAULT);
+                targets[nentries++] = p;
+                
+                if (pass == 0 && nentries < INDEX_MAX_ENTRIES) {
+                    continue;  // plusieurs titres possibles sur une page
+                }
+                break;
+            }
+        }
+    }
+    
+    put_text(index, SCREEN_ROWS, 0, "No + ENVOI, ou SUITE/RETOUR", ATTR_DEFAULT);
+    snprintf(line, sizeof(line), "Choix:%-2s", choice);
+    put_text(index, SCREEN_ROWS, SCREEN_COLS - 8, line, ATTR_DEFAULT | ATTR_INVERSE);
+    
+    return nentries;
+}
+
+/**
+ * @brief Affiche le sommaire et attend un choix
+ * @return Page choisie, ou current si l'on quitte le sommaire
+ */
+int run_index(minitel_t *m, const content_t *content, int current, int delay, int hold) {
+    screen_cells_t index;
+    int targets[INDEX_MAX_ENTRIES];
+    char choice[3] = "";
+    int nentries = build_index_page(content, choice, &index, targets);
+    char msg[128];
+    
+    if (send_frame(m, &index, delay) < 0) {
+        return current;
+    }
+    
+    // Sans action pendant 3 durées de page, on reprend la lecture
+    while (event_wait(m, (long)hold * 3000000L, 1) > 0) {
+        int key;
+        
+        while ((key = key_pop(m)) >= 0) {
+            size_t len = strlen(choice);
+            
+            if (key >= '0' && key <= '9' && len < 2) {
+                choice[len] = (char)key;
+                choice[len + 1] = '\0';
+            } else if (key == KEY_CORRECTION && len > 0) {
+                choice[len - 1] = '\0';
+            } else if (key == KEY_ANNULATION) {
+                choice[0] = '\0';
+            } else if (key == KEY_ENVOI) {
+                int n = atoi(choice);
+                if (n >= 1 && n <= nentries) {
+                    snprintf(msg, sizeof(msg), "Sommaire: entrée %d, page %d", n, targets[n - 1] + 1);
+                    log_message("INFO", msg);
+                    return targets[n - 1];
+                }
+                choice[0] = '\0';
+            } else if (key == KEY_SUITE || key == KEY_RETOUR || key == KEY_SOMMAIRE) {
+                return current;
+            }
+            
+            build_index_page(content, choice, &index, targets);
+            if (send_frame(m, &index, delay) < 0) {
+                return current;
+            }
+        }
+    }
+    
+    return current;
+}
+
+/**
+ * @brief Affiche le fichier page par page (mode page)
+ */
+int send_pages_to_minitel(minitel_t *m, content_t *content, const char *filename, int delay, int hold,
+                          int *page_index) {
+    struct minitel_engine *e = m->engine;
+    int npages;
+    char msg[256];
+    
+    if (m->fd < 0 || !check_serial_connection(m->fd)) {
+        log_message("ERROR", "Port série non connecté");
+        return -1;
+    }
+    
+    if (content_load(content, filename) < 0) {
+        return -1;
+    }
+    npages = content->npages;
+    
+    if (content->type == CONTENT_ANIMATION) {
+        return play_animation(m, content, delay);
+    }
+    
+    if (npages == 0) {
+        log_message("WARN", "Fichier vide !");
+        return 0;
+    }
+    
+    // Reprise à la page affichée avant une reconnexion
+    if (*page_index >= npages) {
+        *page_index = 0;
+    }
+    e->prepared[0].page = -1;
+    e->prepared[1].page = -1;
+    
+    while (*page_index < npages && m->running && !m->reconnect && !m->interrupt) {
+        int p = *page_index;
+        int next = -1;
+        struct timespec deadline;
+        int sent = show_page(m, content, p, delay);
+        
+        if (sent < 0) {
+            return -1;
+        }
+        
+        snprintf(msg, sizeof(msg), "Page %d/%d envoyée: %d octets", p + 1, npages, sent);
+        log_message("INFO", msg);
+        metric_add(&m->metrics.pages_sent, 1);
+        metric_set(&m->metrics.offset, p);
+        sd_status("%s: page %d/%d", filename, p + 1, npages);
+        
+        // Pages voisines encodées d'avance (pendant que la page part):
+        // SUITE et RETOUR partent tout de suite
+        prepare_frame(m, &e->prepared[0], content, p + 1);
+        prepare_frame(m, &e->prepared[1], content, p - 1);
+        
+        // La durée d'affichage court une fois la page entièrement dessinée
+        if (output_flush(m) < 0) {
+            return 0;  // arrêt ou reconnexion
+        }
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += hold;
+        
+        while (next < 0) {
+            int key;
+            int r = event_wait_until(m, &deadline, 1);
+            
+            if (r < 0) {
+                return 0;  // arrêt ou reconnexion
+            }
+            if (r == 0) {
+                next = p + 1;  // défilement automatique
+                break;
+            }
+            
+            while (next < 0 && (key = key_pop(m)) >= 0) {
+                if (key & KEY_FUNCTION) {
+                    snprintf(msg, sizeof(msg), "Touche %s", key_name(key));
+                    log_message("INFO", msg);
+                }
+                
+                if (key == KEY_SUITE) {
+                    next = p + 1;
+                } else if (key == KEY_RETOUR) {
+                    next = p > 0 ? p - 1 : 0;
+                } else if (key == KEY_SOMMAIRE) {
+                    next = run_index(m, content, p, delay, hold);
+                } else if (key == KEY_REPETITION) {
+                    serial_write(m, "\x0C", 1);  // réaffichage complet
+                    next = p;
+                }
+            }
+        }
+        
+        *page_index = next;
+    }
+    
+    if (*page_index >= npages) {
+        *page_index = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Touche la pile d'avance pour qu'elle soit verrouillée en mémoire
+ */
+static void prefault_stack(void) {
+    volatile uint8_t stack[RT_PREFAULT_STACK];
+    
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+/**
+ * @brief Passe un fil en temps réel (option -R), étape par étape
+ * 
+ * Ordonnancement SCHED_FIFO ou SCHED_RR et épinglage sur un cœur si
+ * cpu >= 0, pour thread seulement: les fils créés ensuite n'en héritent
+ * pas. La mémoire est verrouillée pour tout le processus, pile de
+ * l'appelant et tas touchés d'avance (plus de défaut de page pendant le
+ * cadencement). Chaque étape est journalisée, accordée ou non: sans
+ * LimitRTPRIO / LimitMEMLOCK (ou CAP_SYS_NICE / CAP_IPC_LOCK), le fil
+ * reste en temps partagé.
+ * @return nombre d'étapes refusées
+ */
+int realtime_setup(pthread_t thread, int policy, int priority, int cpu) {
+    struct sched_param param;
+    const char *name = policy == SCHED_RR ? "SCHED_RR" : "SCHED_FIFO";
+    char msg[256];
+    int refused = 0;
+    int err;
+    
+    // Mémoire: rien ne doit être rendu au système puis refauté
+    // (-A seul: épinglage sans changer d'ordonnancement ni verrouiller)
+    if (priority > 0) {
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+            prefault_stack();
+            log_message("INFO", "Temps réel: mémoire verrouillée (mlockall)");
+        } else {
+            snprintf(msg, sizeof(msg), "Temps réel: mlockall refusé (%s), augmenter LimitMEMLOCK", strerror(errno));
+            log_message("WARN", msg);
+            refused++;
+        }
+    }
+    
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err == 0) {
+            snprintf(msg, sizeof(msg), "Temps réel: épinglé sur le CPU %d", cpu);
+            log_message("INFO", msg);
+        } else {
+            snprintf(msg, sizeof(msg), "Temps réel: épinglage sur le CPU %d refusé (%s)", cpu, strerror(err));
+            log_message("WARN", msg);
+            refused++;
+        }
+    }
+    
+    if (priority <= 0) {
+        return refused;
+    }
+    
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    if (priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)) {
+        snprintf(msg, sizeof(msg), "Temps réel: priorité %d hors bornes pour %s (%d-%d)", priority, name,
+                 sched_get_priority_min(policy), sched_get_priority_max(policy));
+        log_message("WARN", msg);
+        refused++;
+    } else if ((err = pthread_setschedparam(thread, policy, &param)) == 0) {
+        snprintf(msg, sizeof(msg), "Temps réel: %s priorité %d accordé", name, priority);
+        log_message("INFO", msg);
+    } else {
+        snprintf(msg, sizeof(msg), "Temps réel: %s priorité %d refusé (%s), augmenter LimitRTPRIO",
+                 name, priority, strerror(err));
+        log_message("WARN", msg);
+        refused++;
+    }
+    
+    return refused;
+}
+
@@ -11,77 +11,190 @@
  * - Gestion propre des signaux (SIGTERM, SIGINT)
  * - Pas de fuite mémoire
  * - Logs avec rotation
- * - Watchdog intégré
+ * - Watchdog systemd (sd_notify) piloté par la boucle d'événements
  * - Limite de ressources
+ * 
+ * Ce fichier ne garde que la ligne de commande, la configuration et les
+ * horaires: le port, l'encodeur et le cadencement sont dans libminitel.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <termios.h>
 #include <signal.h>
 #include <errno.h>
+#include <sched.h>
+#include <poll.h>
+#include <stdint.h>
 #include <time.h>
-#include <sys/stat.h>
-#include <sys/time.h>
+#include <stddef.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <pthread.h>
 
-/* Définir _DEFAULT_SOURCE pour cfmakeraw */
-#ifndef _DEFAULT_SOURCE
-#define _DEFAULT_SOURCE
-#endif
+#include "minitel.h"
 
 /* Configuration */
 #define SERIAL_PORT     "/dev/ttyUSB0"
-#define BAUDRATE        B4800
-#define CHARS_PER_LINE  10
-#define LINES_SKIP      30
 #define DEFAULT_DELAY   1000
-#define LOG_FILE        "/tmp/minitel.log"
 #define MAX_RETRIES     5
 #define RETRY_DELAY     5
-#define WATCHDOG_TIMEOUT 60
+#define PASS_PAUSE      1000        // ms entre deux passes
+#define CONFIG_FILE     "minitel.conf"
 
-/* Variables globales pour gestion signaux */
-static volatile sig_atomic_t keep_running = 1;
-static volatile sig_atomic_t reconnect_needed = 0;
-static int fd_global = -1;
+/* Horaires d'ouverture */
+#define SCHEDULE_MAX_WINDOWS 16
+#define SCHEDULE_WARMUP 60          // s: contenus préparés avant l'ouverture
 
 /**
- * @brief Écrit dans le fichier de log avec timestamp
+ * @brief Plage d'ouverture: jours de la semaine, heures, contenu éventuel
  */
-void log_message(const char *level, const char *message) {
-    FILE *log_file;
-    time_t now;
-    char timestamp[64];
-    
-    time(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    log_file = fopen(LOG_FILE, "a");
-    if (log_file != NULL) {
-        fprintf(log_file, "[%s] %s: %s\n", timestamp, level, message);
-        fclose(log_file);
+typedef struct {
+    uint8_t days;           // bit 0 = dimanche ... bit 6 = samedi (struct tm)
+    int start;              // minutes depuis minuit
+    int end;                // minutes depuis minuit, après start (1440 = 24:00)
+    char file[256];         // "" : contenu général (clé file)
+} schedule_window_t;
+
+/**
+ * @brief Réglages: valeurs par défaut, puis fichier de configuration,
+ *        puis ligne de commande
+ */
+typedef struct {
+    char port[128];
+    char file[256];
+    char image[256];        // "" : pas d'intermède
+    char log_file[256];
+    char metrics_file[256]; // "" : export coupé
+    char cache_dir[256];    // "" : pas de cache disque des contenus encodés
+    int delay;
+    int delay_set;          // délai imposé (sinon calibrage ou vitesse de la ligne)
+    int hold;
+    int page_mode;
+    int one_shot;
+    int switch_speed;
+    int chars_per_line;
+    int lines_skip;
+    int max_retries;
+    int retry_delay;
+    int watchdog_timeout;
+    int pass_pause;         // ms entre deux passes (0: enchaînées, tests d'endurance)
+    char schedule[512];     // "" : toujours ouvert
+    schedule_window_t windows[SCHEDULE_MAX_WINDOWS];
+    int nwindows;
+    /* Ligne de commande seulement, lus au démarrage */
+    int calibrate;
+    int use_uring;
+    int rt_policy;
+    int rt_priority;
+    int rt_cpu;
+    const char *mirrors[OUTPUT_MAX_MIRRORS];
+    int mirror_count;
+} config_t;
+
+typedef enum {
+    CONFIG_INT,
+    CONFIG_BOOL,
+    CONFIG_STRING
+} config_kind_t;
+
+#define CONFIG_IN_PORT  1   // admis dans une section [port]
+#define CONFIG_STARTUP  2   // relu, mais appliqué au prochain démarrage seulement
+
+/**
+ * @brief Clé du fichier de configuration et champ de config_t associé
+ */
+typedef struct {
+    const char *key;
+    config_kind_t kind;
+    size_t offset;
+    size_t size;            // chaînes: taille du tampon
+    int min, max;           // entiers
+    int flags;
+} config_key_t;
+
+/* Minitel piloté, et demandes des gestionnaires de signaux */
+static minitel_t minitel;
+static volatile sig_atomic_t reload_requested = 0;
+static volatile sig_atomic_t hup_received = 0;     // journalisés hors du gestionnaire
+static volatile sig_atomic_t stop_signal = 0;
+
+/* Horaires: minuterie du prochain changement (heure locale) */
+static int schedule_timer_fd = -1;
+static int schedule_due = 0;          // horaire à réévaluer
+
+/* Configuration courante, et d'où elle vient */
+static const config_t config_default = {
+    .port = SERIAL_PORT,
+    .file = "text.txt",
+    .log_file = LOG_FILE,
+    .metrics_file = METRICS_FILE,
+    .cache_dir = CACHE_DIR,
+    .delay = DEFAULT_DELAY,
+    .hold = PAGE_HOLD,
+    .chars_per_line = CHARS_PER_LINE,
+    .lines_skip = LINES_SKIP,
+    .max_retries = MAX_RETRIES,
+    .retry_delay = RETRY_DELAY,
+    .watchdog_timeout = WATCHDOG_TIMEOUT,
+    .pass_pause = PASS_PAUSE,
+    .rt_policy = SCHED_FIFO,
+    .rt_cpu = -1,
+};
+static config_t config = config_default;
+static const char *config_path = CONFIG_FILE;
+static int config_required = 0;        // -c: le fichier doit exister
+static int config_watch_fd = -1;
+
+/**
+ * @brief Demande une relecture de la configuration
+ * 
+ * En mode page, la passe est écourtée pour l'appliquer entre deux pages;
+ * en défilement, elle l'est en fin de passe.
+ */
+static void reload_request(minitel_t *m) {
+    reload_requested = 1;
+    if (config.page_mode) {
+        m->interrupt = 1;
     }
-    
-    // Afficher aussi sur stdout
-    printf("[%s] %s: %s\n", timestamp, level, message);
 }
 
 /**
  * @brief Handler pour les signaux (Ctrl+C, kill, etc.)
+ * 
+ * Drapeaux seulement: log_message() alloue et ouvre un fichier, et le
+ * signal peut interrompre le fil principal au milieu du même appel (verrou
+ * de malloc ou de stdio déjà pris: blocage définitif). signals_log() s'en
+ * charge depuis la boucle principale.
  */
 void signal_handler(int signum) {
+    if (signum == SIGINT || signum == SIGTERM) {
+        stop_signal = signum;
+        minitel.running = 0;
+    } else if (signum == SIGHUP) {
+        hup_received = 1;
+        reload_request(&minitel);
+    } else if (signum == SIGUSR1) {
+        minitel.dump = 1;
+    }
+}
+
+/**
+ * @brief Journalise les signaux reçus depuis le dernier appel
+ */
+static void signals_log(void) {
     char msg[100];
     
-    if (signum == SIGINT || signum == SIGTERM) {
-        snprintf(msg, sizeof(msg), "Signal %d reçu, arrêt propre...", signum);
+    if (hup_received) {
+        hup_received = 0;
+        log_message("INFO", "SIGHUP reçu, relecture de la configuration...");
+    }
+    if (stop_signal) {
+        snprintf(msg, sizeof(msg), "Signal %d reçu, arrêt propre...", (int)stop_signal);
+        stop_signal = 0;
         log_message("INFO", msg);
-        keep_running = 0;
-    } else if (signum == SIGHUP) {
-        log_message("INFO", "SIGHUP reçu, reconnexion...");
-        reconnect_needed = 1;
     }
 }
 
@@ -99,354 +212,1081 @@ void setup_signal_handlers(void) {
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
     sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
     
     // Ignorer SIGPIPE (déconnexion port série)
     signal(SIGPIPE, SIG_IGN);
 }
 
+/* Clés du fichier de configuration */
+#define CONFIG_FIELD(field) offsetof(config_t, field), sizeof(((config_t *)0)->field)
+static const config_key_t config_keys[] = {
+    { "port",             CONFIG_STRING, CONFIG_FIELD(port),             0, 0,       CONFIG_STARTUP },
+    { "file",             CONFIG_STRING, CONFIG_FIELD(file),             0, 0,       CONFIG_IN_PORT },
+    { "image",            CONFIG_STRING, CONFIG_FIELD(image),            0, 0,       CONFIG_IN_PORT },
+    { "log_file",         CONFIG_STRING, CONFIG_FIELD(log_file),         0, 0,       0 },
+    { "metrics_file",     CONFIG_STRING, CONFIG_FIELD(metrics_file),     0, 0,       0 },
+    { "cache_dir",        CONFIG_STRING, CONFIG_FIELD(cache_dir),        0, 0,       0 },
+    { "delay",            CONFIG_INT,    CONFIG_FIELD(delay),            0, 1000000, CONFIG_IN_PORT },
+    { "hold",             CONFIG_INT,    CONFIG_FIELD(hold),             1, 3600,    CONFIG_IN_PORT },
+    { "page_mode",        CONFIG_BOOL,   CONFIG_FIELD(page_mode),        0, 1,       CONFIG_IN_PORT },
+    { "one_shot",         CONFIG_BOOL,   CONFIG_FIELD(one_shot),         0, 1,       0 },
+    { "switch_speed",     CONFIG_BOOL,   CONFIG_FIELD(switch_speed),     0, 1,       CONFIG_IN_PORT },
+    { "chars_per_line",   CONFIG_INT,    CONFIG_FIELD(chars_per_line),   1, 80,      CONFIG_IN_PORT },
+    { "lines_skip",       CONFIG_INT,    CONFIG_FIELD(lines_skip),       0, 100,     CONFIG_IN_PORT },
+    { "max_retries",      CONFIG_INT,    CONFIG_FIELD(max_retries),      1, 10000,   0 },
+    { "retry_delay",      CONFIG_INT,    CONFIG_FIELD(retry_delay),      1, 3600,    0 },
+    { "watchdog_timeout", CONFIG_INT,    CONFIG_FIELD(watchdog_timeout), 1, 3600,    0 },
+    { "pass_pause",       CONFIG_INT,    CONFIG_FIELD(pass_pause),       0, 3600000, 0 },
+    { "schedule",         CONFIG_STRING, CONFIG_FIELD(schedule),         0, 0,       CONFIG_IN_PORT },
+};
+#define CONFIG_KEYS (sizeof(config_keys) / sizeof(config_keys[0]))
+
 /**
- * @brief Vérifie si le port série est toujours connecté
+ * @brief Lit les horaires d'ouverture
+ * 
+ * Plages séparées par ';': jours, heures, puis un fichier facultatif
+ * affiché pendant la plage à la place du contenu général.
+ *   mon-fri 09:00-12:00 matin.txt; mon-fri 14:00-18:00; sat 10:00-12:30
+ * Jours: mon..sun ou lun..dim, listes (mon,wed) et intervalles (mon-fri),
+ * '*' pour tous les jours. Une plage ne passe pas minuit (24:00 admis).
+ * @return nombre de plages, -1 si la syntaxe est invalide
  */
-int check_serial_connection(int fd) {
-    char test_byte = 0;
-    int result;
+static int schedule_parse(const char *text, schedule_window_t *windows) {
+    static const char *names[] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat",
+                                   "dim", "lun", "mar", "mer", "jeu", "ven", "sam" };
+    char copy[512];
+    char *saveptr = NULL;
+    int count = 0;
     
-    if (fd < 0) {
-        return 0;
+    snprintf(copy, sizeof(copy), "%s", text);
+    for (char *item = strtok_r(copy, ";", &saveptr); item != NULL; item = strtok_r(NULL, ";", &saveptr)) {
+        schedule_window_t *w = &windows[count];
+        char days[64], file[256] = "";
+        int h1, m1, h2, m2;
+        int fields;
+        
+        while (*item == ' ' || *item == '\t') item++;
+        if (*item == '\0') {
+            continue;
+        }
+        if (count == SCHEDULE_MAX_WINDOWS) {
+            return -1;
+        }
+        
+        fields = sscanf(item, "%63s %d:%d-%d:%d %255s", days, &h1, &m1, &h2, &m2, file);
+        if (fields < 5 || h1 < 0 || h1 > 23 || m1 < 0 || m1 > 59 || h2 < 0 || m2 < 0 || m2 > 59 ||
+            h2 * 60 + m2 > 1440 || h2 * 60 + m2 <= h1 * 60 + m1) {
+            return -1;
+        }
+        
+        memset(w, 0, sizeof(*w));
+        w->start = h1 * 60 + m1;
+        w->end = h2 * 60 + m2;
+        snprintf(w->file, sizeof(w->file), "%s", file);
+        
+        // Jours: liste d'intervalles
+        for (char *day = days; *day != '\0'; ) {
+            int first = -1, last;
+            
+            if (*day == '*') {
+                w->days = 0x7F;
+                day++;
+            } else {
+                for (int n = 0; n < 14; n++) {
+                    if (strncasecmp(day, names[n], 3) == 0) {
+                        first = n % 7;
+                    }
+                }
+                if (first < 0) {
+                    return -1;
+                }
+                last = first;
+                day += 3;
+                if (*day == '-') {
+                    last = -1;
+                    for (int n = 0; n < 14; n++) {
+                        if (strncasecmp(day + 1, names[n], 3) == 0) {
+                            last = n % 7;
+                        }
+                    }
+                    if (last < 0) {
+                        return -1;
+                    }
+                    day += 4;
+                }
+                for (int d = first; ; d = (d + 1) % 7) {
+                    w->days |= 1 << d;
+                    if (d == last) {
+                        break;
+                    }
+                }
+            }
+            if (*day == ',') {
+                day++;
+            } else if (*day != '\0') {
+                return -1;
+            }
+        }
+        count++;
     }
+    return count;
+}
+
+/**
+ * @brief Range une valeur dans config_t, après contrôle
+ * @return 0, ou -1 si la valeur est invalide (cfg inchangé)
+ */
+static int config_set(config_t *cfg, const config_key_t *key, const char *value) {
+    uint8_t *field = (uint8_t *)cfg + key->offset;
     
-    // Test non-bloquant
-    int flags = fcntl(fd, F_GETFL, 0);
-    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-    
-    result = write(fd, &test_byte, 0);
-    
-    fcntl(fd, F_SETFL, flags);
+    if (key->offset == offsetof(config_t, schedule)) {
+        schedule_window_t windows[SCHEDULE_MAX_WINDOWS];
+        int count = schedule_parse(value, windows);
+        if (count < 0 || strlen(value) >= key->size) {
+            return -1;
+        }
+        memcpy(cfg->windows, windows, sizeof(windows));
+        cfg->nwindows = count;
+    }
     
-    if (result < 0 && errno == EBADF) {
-        return 0;
+    if (key->kind == CONFIG_STRING) {
+        if (strlen(value) >= key->size) {
+            return -1;
+        }
+        memcpy(field, value, strlen(value) + 1);
+    } else if (key->kind == CONFIG_BOOL) {
+        if (strcasecmp(value, "yes") == 0 || strcasecmp(value, "oui") == 0 ||
+            strcasecmp(value, "true") == 0 || strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0) {
+            *(int *)field = 1;
+        } else if (strcasecmp(value, "no") == 0 || strcasecmp(value, "non") == 0 ||
+                   strcasecmp(value, "false") == 0 || strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0) {
+            *(int *)field = 0;
+        } else {
+            return -1;
+        }
+    } else {
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (*value == '\0' || *end != '\0' || n < key->min || n > key->max) {
+            return -1;
+        }
+        *(int *)field = (int)n;
     }
     
-    return 1;
+    if (key->offset == offsetof(config_t, delay)) {
+        cfg->delay_set = 1;
+    }
+    return 0;
 }
 
 /**
- * @brief Ouvre et configure le port série
+ * @brief Lit le fichier de configuration (format INI)
+ * 
+ * Format: une clé par ligne, les sections [PORT] ne s'appliquent qu'à ce port.
+ *   # commentaire
+ *   file = /home/pi/message.txt
+ *   [/dev/ttyUSB0]
+ *   delay = 2083
+ * @param section NULL pour les clés hors section, sinon le port dont on
+ *        lit la section
+ * @return nombre d'erreurs (fichier absent non demandé: 0), -1 si illisible
  */
-int open_serial_port(const char *port) {
-    int fd;
-    struct termios options;
-    char msg[256];
+static int config_parse(const char *path, config_t *cfg, const char *section) {
+    FILE *file;
+    char line[512];
+    char current[128] = "";
+    int line_no = 0;
+    int errors = 0;
+    char msg[800];
     
-    fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
-    if (fd < 0) {
-        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", port, strerror(errno));
+    file = fopen(path, "r");
+    if (file == NULL) {
+        if (errno == ENOENT && !config_required) {
+            return 0;
+        }
+        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", path, strerror(errno));
         log_message("ERROR", msg);
         return -1;
     }
     
-    // Configuration port série
-    if (tcgetattr(fd, &options) < 0) {
-        log_message("ERROR", "tcgetattr failed");
-        close(fd);
-        return -1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *key = line;
+        char *value;
+        char *end;
+        const config_key_t *found = NULL;
+        
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        while (*key == ' ' || *key == '\t') key++;
+        if (*key == '\0' || *key == '#' || *key == ';') {
+            continue;
+        }
+        
+        if (*key == '[') {
+            end = strchr(key, ']');
+            if (end == NULL || end == key + 1 || (size_t)(end - key - 1) >= sizeof(current)) {
+                snprintf(msg, sizeof(msg), "%s:%d: section invalide", path, line_no);
+                log_message("ERROR", msg);
+                errors++;
+                current[0] = '\0';
+                continue;
+            }
+            snprintf(current, sizeof(current), "%.*s", (int)(end - key - 1), key + 1);
+            continue;
+        }
+        
+        // Lignes de la section demandée seulement
+        if (section == NULL ? current[0] != '\0' : strcmp(current, section) != 0) {
+            continue;
+        }
+        
+        value = strchr(key, '=');
+        if (value == NULL) {
+            snprintf(msg, sizeof(msg), "%s:%d: '=' attendu", path, line_no);
+            log_message("ERROR", msg);
+            errors++;
+            continue;
+        }
+        end = value;
+        *value++ = '\0';
+        while (end > key && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+        while (*value == ' ' || *value == '\t') value++;
+        end = value + strlen(value);
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+        
+        for (size_t k = 0; k < CONFIG_KEYS; k++) {
+            if (strcmp(config_keys[k].key, key) == 0) {
+                found = &config_keys[k];
+            }
+        }
+        
+        if (found == NULL) {
+            snprintf(msg, sizeof(msg), "%s:%d: clé inconnue: %s", path, line_no, key);
+        } else if (section != NULL && !(found->flags & CONFIG_IN_PORT)) {
+            snprintf(msg, sizeof(msg), "%s:%d: %s n'est pas réglable par port", path, line_no, key);
+        } else if (config_set(cfg, found, value) < 0) {
+            snprintf(msg, sizeof(msg), "%s:%d: valeur invalide pour %s: %s", path, line_no, key, value);
+        } else {
+            continue;
+        }
+        log_message("ERROR", msg);
+        errors++;
     }
     
-    cfsetispeed(&options, BAUDRATE);
-    cfsetospeed(&options, BAUDRATE);
-    cfmakeraw(&options);
+    fclose(file);
+    return errors;
+}
+
+/**
+ * @brief Vide les événements inotify; demande une relecture si le fichier a changé
+ */
+static void config_watch_read(minitel_t *m, int fd) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const char *slash = strrchr(config_path, '/');
+    const char *name = slash ? slash + 1 : config_path;
+    ssize_t len;
+    
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, name) == 0) {
+                reload_request(m);
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+/**
+ * @brief Surveille le fichier de configuration (inotify sur son répertoire)
+ * 
+ * Le répertoire plutôt que le fichier: les éditeurs remplacent souvent le
+ * fichier par un nouveau (renommage), ce qui ferait perdre la surveillance.
+ * La boucle d'événements sert le descripteur pendant les passes.
+ */
+static int config_watch(const char *path) {
+    char dir[256];
+    const char *slash = strrchr(path, '/');
     
-    // Timeouts
-    options.c_cc[VMIN] = 0;
-    options.c_cc[VTIME] = 10;
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path) + (slash == path) : 1, slash ? path : ".");
     
-    if (tcsetattr(fd, TCSANOW, &options) < 0) {
-        log_message("ERROR", "tcsetattr failed");
-        close(fd);
+    config_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (config_watch_fd < 0 ||
+        inotify_add_watch(config_watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_message("WARN", "Surveillance de la configuration impossible (relecture par SIGHUP seulement)");
         return -1;
     }
     
-    // Remettre en mode bloquant
-    int flags = fcntl(fd, F_GETFL, 0);
-    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
-    
-    snprintf(msg, sizeof(msg), "Port série %s ouvert avec succès", port);
-    log_message("INFO", msg);
+    return event_loop_watch(&minitel, config_watch_fd, config_watch_read);
+}
+
+/**
+ * @brief Affiche l'aide
+ */
+void print_usage(const char *progname) {
+    printf("Usage: %s [OPTIONS]\n\n", progname);
+    printf("Options:\n");
+    printf("  -f FILE     Fichier texte (défaut: text.txt)\n");
+    printf("  -d DELAY    Délai en µs (défaut: 1000)\n");
+    printf("  -p PORT     Port série (défaut: /dev/ttyUSB0)\n");
+    printf("  -o          Mode one-shot\n");
+    printf("  -P          Mode page (écrans 40x24, mise à jour différentielle)\n");
+    printf("  -t HOLD     Durée d'affichage d'une page en s (défaut: %d)\n", PAGE_HOLD);
+    printf("  -i IMAGE    Image PGM/PPM ou animation .anim avant chaque passe\n");
+    printf("  -S          Passer le Minitel à sa vitesse maximale à la connexion\n");
+    printf("  -C          Calibrer le débit du port, l'enregistrer dans %s et quitter\n", CALIBRATION_FILE);
+    printf("  -R PRIO     Fil d'écriture en SCHED_FIFO (ou rr:PRIO pour SCHED_RR), mémoire verrouillée\n");
+    printf("  -A CPU      Épingler le fil d'écriture sur ce cœur\n");
+    printf("  -m PORT     Port miroir recevant les mêmes octets (répétable, %d au plus)\n", OUTPUT_MAX_MIRRORS);
+    printf("  -U          Écriture via io_uring (délais liés), repli automatique sinon\n");
+    printf("  -l LOGFILE  Fichier de log (défaut: %s)\n", LOG_FILE);
+    printf("  -w HORAIRES Plages d'ouverture (ex: \"mon-fri 09:00-18:00\"), veille en dehors\n");
+    printf("  -c CONFIG   Fichier de configuration (défaut: %s s'il existe)\n", CONFIG_FILE);
+    printf("  -M FILE     Export des métriques Prometheus (défaut: %s, \"\" pour couper)\n", METRICS_FILE);
+    printf("  -h          Cette aide\n");
+}
+
+/**
+ * @brief Heure murale exacte, à la seconde
+ * 
+ * time() lit l'horloge grossière, en retard de quelques millisecondes sur
+ * l'échéance de la minuterie: une frontière de plage paraîtrait encore à
+ * venir au réveil.
+ */
+static time_t schedule_now(void) {
+    struct timespec ts;
     
-    return fd;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec;
 }
 
 /**
- * @brief Initialise l'écran du Minitel
+ * @brief Plage d'ouverture en cours à l'instant t
+ * @return indice de la plage (0 sans horaires: toujours ouvert), -1 si fermé
  */
-int init_minitel_screen(int fd) {
-    if (fd < 0 || !check_serial_connection(fd)) {
-        return -1;
-    }
+static int schedule_current(const config_t *cfg, time_t t) {
+    struct tm tm;
+    int minute;
     
-    // Effacer l'écran
-    if (write(fd, "\x0C", 1) < 0) {
-        log_message("ERROR", "Erreur écriture clear screen");
-        return -1;
+    if (cfg->nwindows == 0) {
+        return 0;
     }
-    usleep(300000);
     
-    // Sauter 10 lignes
-    if (write(fd, "\n\n\n\n\n\n\n\n\n\n", 10) < 0) {
-        log_message("ERROR", "Erreur écriture lignes");
-        return -1;
+    localtime_r(&t, &tm);
+    minute = tm.tm_hour * 60 + tm.tm_min;
+    for (int w = 0; w < cfg->nwindows; w++) {
+        const schedule_window_t *window = &cfg->windows[w];
+        if ((window->days & (1 << tm.tm_wday)) && minute >= window->start && minute < window->end) {
+            return w;
+        }
     }
-    
-    log_message("INFO", "Écran Minitel initialisé");
-    return 0;
+    return -1;
 }
 
 /**
- * @brief Envoie le fichier au Minitel avec gestion d'erreurs
+ * @brief Contenu affiché pendant une plage (son fichier, sinon le contenu général)
  */
-int send_file_to_minitel(int fd, const char *filename, int delay) {
-    FILE *file;
-    int c;  // IMPORTANT: int, pas char, pour détecter EOF
-    int count = 0;
-    int bytes_sent = 0;
-    char msg[256];
-    
-    printf("[DEBUG] send_file_to_minitel: début, fd=%d, filename=%s\n", fd, filename);
-    
-    if (fd < 0 || !check_serial_connection(fd)) {
-        printf("[DEBUG] Port série non connecté !\n");
-        log_message("ERROR", "Port série non connecté");
-        return -1;
+static const char *schedule_file(const config_t *cfg, int window) {
+    if (window >= 0 && window < cfg->nwindows && cfg->windows[window].file[0] != '\0') {
+        return cfg->windows[window].file;
     }
+    return cfg->file;
+}
+
+/**
+ * @brief Prochain début ou fin de plage après t (heure locale, changements d'heure compris)
+ */
+static time_t schedule_next_change(const config_t *cfg, time_t t) {
+    time_t next = t + 8 * 86400;  // aucune plage: réévaluer la semaine prochaine
+    struct tm day;
     
-    printf("[DEBUG] Ouverture fichier %s...\n", filename);
-    file = fopen(filename, "r");
-    if (file == NULL) {
-        printf("[DEBUG] ERREUR fopen: %s\n", strerror(errno));
-        snprintf(msg, sizeof(msg), "Erreur ouverture %s: %s", filename, strerror(errno));
-        log_message("ERROR", msg);
-        return -1;
+    localtime_r(&t, &day);
+    for (int offset = 0; offset <= 7; offset++) {
+        for (int w = 0; w < cfg->nwindows; w++) {
+            const schedule_window_t *window = &cfg->windows[w];
+            int bounds[2] = { window->start, window->end };
+            
+            if (!(window->days & (1 << ((day.tm_wday + offset) % 7)))) {
+                continue;
+            }
+            for (int b = 0; b < 2; b++) {
+                struct tm at = day;
+                time_t when;
+                
+                at.tm_mday += offset;
+                at.tm_hour = bounds[b] / 60;
+                at.tm_min = bounds[b] % 60;
+                at.tm_sec = 0;
+                at.tm_isdst = -1;
+                when = mktime(&at);
+                if (when > t && when < next) {
+                    next = when;
+                }
+            }
+        }
     }
+    return next;
+}
+
+/**
+ * @brief Arme la minuterie du planning à l'instant when (0: désarmée)
+ * 
+ * Heure murale absolue: un recalage de l'horloge (NTP au démarrage du Pi)
+ * réveille aussitôt la minuterie, qui est alors réévaluée.
+ */
+static void schedule_arm(time_t when) {
+    struct itimerspec its;
     
-    // Debug: vérifier la taille du fichier
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = when;
+    timerfd_settime(schedule_timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, NULL);
+}
+
+/**
+ * @brief Minuterie du planning échue pendant une passe: celle-ci est écourtée
+ */
+static void schedule_timer_read(minitel_t *m, int fd) {
+    uint64_t expirations;
     
-    printf("[DEBUG] Taille fichier: %ld octets\n", file_size);
-    snprintf(msg, sizeof(msg), "Lecture de %s (%ld octets)", filename, file_size);
-    log_message("INFO", msg);
+    // Changement d'horaire, ou horloge recalée (-ECANCELED): à réévaluer
+    if (read(fd, &expirations, sizeof(expirations)) > 0 || errno == ECANCELED) {
+        schedule_due = 1;
+        m->interrupt = 1;
+    }
+}
+
+/**
+ * @brief Attend l'ouverture suivante, port fermé, sur la seule minuterie du planning
+ * 
+ * Ni cadencement, ni watchdog, ni export des métriques pendant ce temps:
+ * le processus ne se réveille qu'à l'heure dite, sur signal ou si la
+ * configuration change. Sous systemd, le délai du watchdog est étendu
+ * jusque-là (WATCHDOG_USEC). SCHEDULE_WARMUP secondes avant l'ouverture,
+ * les contenus de la plage sont chargés et mis en page: le premier écran
+ * part dès l'ouverture du port.
+ */
+static void schedule_park(content_t *content, content_t *image_content) {
+    struct pollfd fds[2] = { { .fd = schedule_timer_fd, .events = POLLIN },
+                             { .fd = config_watch_fd, .events = POLLIN } };
+    char when[64];
+    char msg[400];
+    int preloaded = 0;
     
-    if (file_size == 0) {
-        printf("[DEBUG] Fichier vide !\n");
-        log_message("WARN", "Fichier vide !");
-        fclose(file);
-        return 0;  // Pas une erreur, juste vide
-    }
-    
-    // Lire et envoyer
-    printf("[DEBUG] Début lecture caractères...\n");
-    while (keep_running && (c = fgetc(file)) != EOF) {
-        // Vérifier connexion tous les 100 caractères
-        if (bytes_sent % 100 == 0 && !check_serial_connection(fd)) {
-            printf("[DEBUG] Connexion perdue à %d octets\n", bytes_sent);
-            log_message("ERROR", "Connexion perdue pendant l'envoi");
-            fclose(file);
-            return -1;
+    metric_set(&minitel.metrics.schedule_open, 0);
+    metrics_export(&minitel);
+    
+    while (minitel.running && !reload_requested) {
+        time_t now = schedule_now();
+        time_t opening = schedule_next_change(&config, now);
+        time_t wake = preloaded ? opening : opening - SCHEDULE_WARMUP;
+        struct tm tm;
+        uint64_t expirations;
+        
+        if (schedule_current(&config, now) >= 0) {
+            break;
         }
         
-        // Ignorer les sauts de ligne
-        if (c == '\n') {
+        localtime_r(&opening, &tm);
+        strftime(when, sizeof(when), "%d/%m %H:%M", &tm);
+        if (!preloaded && now >= wake) {
+            struct timespec t0, t1;
+            const char *file = schedule_file(&config, schedule_current(&config, opening));
+            
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            content_load(content, file);
+            if (config.image[0] != '\0') {
+                content_load(image_content, config.image);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            snprintf(msg, sizeof(msg), "Contenus préparés pour l'ouverture de %s (%.1f ms)", when,
+                     elapsed_us(&t0, &t1) / 1e3);
+            log_message("INFO", msg);
+            preloaded = 1;
             continue;
         }
         
-        // Envoyer le caractère
-        if (write(fd, &c, 1) < 0) {
-            printf("[DEBUG] Erreur write à %d octets: %s\n", bytes_sent, strerror(errno));
-            log_message("ERROR", "Erreur écriture caractère");
-            fclose(file);
-            return -1;
+        snprintf(msg, sizeof(msg), "Hors horaires: écran éteint, port libéré jusqu'au %s", when);
+        log_message("INFO", msg);
+        sd_status("Fermé jusqu'au %s", when);
+        if (sd_watchdog_usec() > 0) {
+            snprintf(msg, sizeof(msg), "WATCHDOG_USEC=%lld", (long long)(wake - now + 60) * 1000000LL);
+            sd_notify_send(msg);
+            sd_notify_send("WATCHDOG=1");
         }
         
-        bytes_sent++;
-        count++;
-        
-        // Retour à la ligne
-        if (count >= CHARS_PER_LINE) {
-            if (write(fd, "\r\n", 2) < 0) {
-                printf("[DEBUG] Erreur write \\r\\n: %s\n", strerror(errno));
-                log_message("ERROR", "Erreur retour ligne");
-                fclose(file);
-                return -1;
+        schedule_arm(wake);
+        if (poll(fds, config_watch_fd >= 0 ? 2 : 1, -1) < 0) {
+            continue;  // signal: arrêt ou relecture
+        }
+        if (fds[0].revents & POLLIN) {
+            if (read(schedule_timer_fd, &expirations, sizeof(expirations)) < 0 && errno == ECANCELED) {
+                log_message("INFO", "Horloge recalée, horaires réévalués");
             }
-            count = 0;
         }
-        
-        usleep(delay);
+        if (config_watch_fd >= 0 && (fds[1].revents & POLLIN)) {
+            config_watch_read(&minitel, config_watch_fd);
+        }
     }
     
-    printf("[DEBUG] Fin lecture. keep_running=%d, bytes_sent=%d\n", keep_running, bytes_sent);
+    // Retour au rythme normal du watchdog
+    if (sd_watchdog_usec() > 0) {
+        snprintf(msg, sizeof(msg), "WATCHDOG_USEC=%ld", sd_watchdog_usec());
+        sd_notify_send(msg);
+        sd_notify_send("WATCHDOG=1");
+    }
+    schedule_due = 1;
+}
+
+/**
+ * @brief Chargement des contenus en parallèle de l'ouverture du port
+ */
+typedef struct {
+    pthread_t thread;
+    int running;                // fil lancé, pas encore rejoint
+    content_t *content;
+    content_t *image_content;
+    const char *file;
+} preload_t;
+
+static preload_t preload;
+
+static void *preload_main(void *arg) {
+    preload_t *p = arg;
+    struct timespec t0, t1;
+    char msg[400];
     
-    fclose(file);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (content_load(p->content, p->file) == 0 && !config.page_mode && p->content->stream != NULL) {
+        content_segments(p->content, config.chars_per_line, config.lines_skip);
+    }
+    if (config.image[0] != '\0') {
+        content_load(p->image_content, config.image);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    snprintf(msg, sizeof(msg), "Contenus préparés pendant l'ouverture du port (%.1f ms)", elapsed_us(&t0, &t1) / 1e3);
+    log_message("INFO", msg);
+    return NULL;
+}
+
+/**
+ * @brief Lance le chargement et l'encodage des contenus de la plage window
+ * 
+ * Au démarrage, l'ouverture du port, l'identification du terminal et
+ * l'effacement de l'écran prennent plusieurs centaines de millisecondes:
+ * le texte est lu et mis en segments pendant ce temps. Les contenus
+ * n'appartiennent qu'au fil de chargement jusqu'à preload_join().
+ */
+static void preload_start(content_t *content, content_t *image_content, int window) {
+    preload.content = content;
+    preload.image_content = image_content;
+    preload.file = schedule_file(&config, window);
+    preload.running = pthread_create(&preload.thread, NULL, preload_main, &preload) == 0;
+    if (!preload.running) {
+        log_message("WARN", "Chargement parallèle impossible, contenus chargés à l'envoi");
+    }
+}
+
+/**
+ * @brief Attend la fin du chargement parallèle (sans effet s'il n'y en a pas)
+ */
+static void preload_join(void) {
+    if (preload.running) {
+        pthread_join(preload.thread, NULL);
+        preload.running = 0;
+    }
+}
+
+/**
+ * @brief Règle une clé de configuration depuis une option de la ligne de commande
+ */
+static int config_option(config_t *cfg, const char *key, const char *value) {
+    for (size_t k = 0; k < CONFIG_KEYS; k++) {
+        if (strcmp(config_keys[k].key, key) == 0) {
+            return config_set(cfg, &config_keys[k], value);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Applique les options de la ligne de commande sur cfg
+ * 
+ * Rappelée à chaque relecture: la ligne de commande garde le dernier mot
+ * sur le fichier de configuration.
+ * @return 0, 1 si l'aide est demandée, -1 si une option est invalide
+ */
+static int parse_options(int argc, char *argv[], config_t *cfg) {
+    int opt;
+    
+    optind = 0;  // getopt repart du début
+    cfg->mirror_count = 0;
     
-    printf("[DEBUG] Fichier fermé\n");
+    while ((opt = getopt(argc, argv, "f:d:p:m:l:c:w:oPt:i:SCUM:R:A:h")) != -1) {
+        const char *key = NULL;
+        
+        switch (opt) {
+            case 'f': key = "file"; break;
+            case 'd': key = "delay"; break;
+            case 'p': key = "port"; break;
+            case 't': key = "hold"; break;
+            case 'i': key = "image"; break;
+            case 'l': key = "log_file"; break;
+            case 'M': key = "metrics_file"; break;
+            case 'w': key = "schedule"; break;
+            case 'c':
+                config_path = optarg;
+                config_required = 1;
+                break;
+            case 'm':
+                if (cfg->mirror_count == OUTPUT_MAX_MIRRORS) {
+                    fprintf(stderr, "Au plus %d ports miroirs\n", OUTPUT_MAX_MIRRORS);
+                    return -1;
+                }
+                cfg->mirrors[cfg->mirror_count++] = optarg;
+                break;
+            case 'o': cfg->one_shot = 1; break;
+            case 'P': cfg->page_mode = 1; break;
+            case 'S': cfg->switch_speed = 1; break;
+            case 'C': cfg->calibrate = 1; break;
+            case 'U': cfg->use_uring = 1; break;
+            case 'R':
+                if (strncmp(optarg, "rr:", 3) == 0) {
+                    cfg->rt_policy = SCHED_RR;
+                    optarg += 3;
+                } else if (strncmp(optarg, "fifo:", 5) == 0) {
+                    optarg += 5;
+                }
+                cfg->rt_priority = atoi(optarg);
+                break;
+            case 'A': cfg->rt_cpu = atoi(optarg); break;
+            case 'h': return 1;
+            default: return -1;
+        }
+        
+        if (key != NULL && config_option(cfg, key, optarg) < 0) {
+            fprintf(stderr, "Valeur invalide pour -%c: %s\n", opt, optarg);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Construit la configuration: défauts, fichier, ligne de commande
+ * 
+ * La section du port s'applique par-dessus les clés générales; le port
+ * lui-même peut venir du fichier ou de -p, d'où les deux passes.
+ * @return nombre d'erreurs dans le fichier
+ */
+static int config_build(int argc, char *argv[], config_t *cfg) {
+    int errors, section;
+    
+    *cfg = config_default;
+    errors = config_parse(config_path, cfg, NULL);
+    if (errors < 0) {
+        return 1;
+    }
+    parse_options(argc, argv, cfg);
+    section = config_parse(config_path, cfg, cfg->port);
+    parse_options(argc, argv, cfg);
+    return section < 0 ? 1 : errors + section;
+}
+
+/**
+ * @brief Reporte sur le contexte les réglages dont la bibliothèque a besoin
+ */
+static void config_apply(const config_t *cfg) {
+    minitel.chars_per_line = cfg->chars_per_line;
+    minitel.lines_skip = cfg->lines_skip;
+    minitel.watchdog_timeout = cfg->watchdog_timeout;
+    snprintf(minitel.metrics_file, sizeof(minitel.metrics_file), "%s", cfg->metrics_file);
+    log_set_file(cfg->log_file);
+    content_cache_set_dir(cfg->cache_dir);
+}
+
+/**
+ * @brief Relit la configuration et applique ce qui a changé, sans couper le port
+ * 
+ * Une configuration invalide est écartée en bloc: l'ancienne reste en
+ * place. Seuls les contenus dont le fichier a changé sont recalculés;
+ * le port attend le prochain démarrage.
+ * @return 1 si le contenu principal a changé, 0 si appliquée, -1 si rejetée
+ */
+static int config_reload(int argc, char *argv[], content_t *content, content_t *image_content) {
+    config_t next;
+    char changed[400] = "";
+    char msg[600];
+    int errors = config_build(argc, argv, &next);
+    int content_changed = 0;
     
-    // Retour chariot avant de sauter les lignes
-    printf("[DEBUG] Envoi retour chariot...\n");
-    if (write(fd, "\r", 1) < 0) {
-        printf("[DEBUG] Erreur retour chariot: %s\n", strerror(errno));
-        log_message("ERROR", "Erreur retour chariot");
+    if (errors > 0) {
+        snprintf(msg, sizeof(msg), "Configuration %s rejetée (%d erreur(s)), réglages inchangés", config_path, errors);
+        log_message("ERROR", msg);
         return -1;
     }
     
-    // Sauter 30 lignes
-    printf("[DEBUG] Saut de %d lignes...\n", LINES_SKIP);
-    for (int i = 0; i < LINES_SKIP && keep_running; i++) {
-        if (write(fd, "\n", 1) < 0) {
-            printf("[DEBUG] Erreur saut ligne %d: %s\n", i, strerror(errno));
-            log_message("ERROR", "Erreur saut lignes");
-            return -1;
+    for (size_t k = 0; k < CONFIG_KEYS; k++) {
+        const config_key_t *key = &config_keys[k];
+        uint8_t *old = (uint8_t *)&config + key->offset;
+        uint8_t *new = (uint8_t *)&next + key->offset;
+        int differs = key->kind == CONFIG_STRING ? strcmp((char *)old, (char *)new) != 0
+                                                 : *(int *)old != *(int *)new;
+        
+        if (key->offset == offsetof(config_t, delay)) {
+            differs |= config.delay_set != next.delay_set;
+        }
+        if (!differs) {
+            continue;
+        }
+        
+        if (key->flags & CONFIG_STARTUP) {
+            snprintf(msg, sizeof(msg), "Configuration: %s sera pris en compte au prochain démarrage", key->key);
+            log_message("WARN", msg);
+            memcpy(new, old, key->size);
+            continue;
         }
+        
+        snprintf(changed + strlen(changed), sizeof(changed) - strlen(changed), "%s%s",
+                 changed[0] ? ", " : "", key->key);
     }
     
-    printf("[DEBUG] send_file_to_minitel: succès, %d octets envoyés\n", bytes_sent);
-    snprintf(msg, sizeof(msg), "Fichier envoyé: %d octets", bytes_sent);
-    log_message("INFO", msg);
+    // Caches: seul le contenu dont le chemin change est à recalculer
+    if (strcmp(config.file, next.file) != 0) {
+        content_free(content);
+        content_changed = 1;
+    }
+    if (strcmp(config.image, next.image) != 0) {
+        content_free(image_content);
+    }
     
-    // Debug
-    if (bytes_sent == 0) {
-        printf("[DEBUG] ATTENTION: Aucun octet envoyé !\n");
-        log_message("WARN", "Aucun octet envoyé ! Fichier vide ou que des retours ligne ?");
+    int rearm = config.watchdog_timeout != next.watchdog_timeout;
+    config = next;
+    config_apply(&config);
+    if (rearm) {
+        watchdog_arm(&minitel);
     }
     
-    return 0;
+    snprintf(msg, sizeof(msg), "Configuration %s relue: %s", config_path, changed[0] ? changed : "inchangée");
+    log_message("INFO", msg);
+    return content_changed;
 }
 
 /**
- * @brief Affiche l'aide
+ * @brief Délai entre caractères: imposé, calibré pour ce port, sinon calé
+ *        sur la vitesse de la ligne
  */
-void print_usage(const char *progname) {
-    printf("Usage: %s [OPTIONS]\n\n", progname);
-    printf("Options:\n");
-    printf("  -f FILE     Fichier texte (défaut: text.txt)\n");
-    printf("  -d DELAY    Délai en µs (défaut: 1000)\n");
-    printf("  -p PORT     Port série (défaut: /dev/ttyUSB0)\n");
-    printf("  -o          Mode one-shot\n");
-    printf("  -h          Cette aide\n");
+static int pacing_delay(const config_t *cfg, int probed) {
+    char msg[256];
+    int calibrated;
+    
+    if (cfg->delay_set || cfg->calibrate) {
+        return cfg->delay;
+    }
+    
+    calibrated = calibration_load(CALIBRATION_FILE, cfg->port, minitel.terminal.speed);
+    if (calibrated > 0) {
+        snprintf(msg, sizeof(msg), "Délai calibré pour %s à %d bauds: %dµs", cfg->port, minitel.terminal.speed, calibrated);
+        log_message("INFO", msg);
+        return calibrated;
+    }
+    if (probed) {
+        int delay = (int)(10000000L / minitel.terminal.speed);
+        snprintf(msg, sizeof(msg), "Délai calé sur %d bauds: %dµs", minitel.terminal.speed, delay);
+        log_message("INFO", msg);
+        return delay;
+    }
+    return cfg->delay;
 }
 
 /**
  * @brief Main robuste avec reconnexion automatique
  */
 int main(int argc, char *argv[]) {
-    const char *filename = "text.txt";
-    const char *port = SERIAL_PORT;
-    int delay = DEFAULT_DELAY;
-    int one_shot = 0;
-    int opt;
+    static content_t content;
+    static content_t image_content;
+    int delay;
+    int page_index = 0;
+    int window = 0;
     int retry_count = 0;
-    time_t last_watchdog = time(NULL);
-    char msg[256];
+    int ready = 0;
+    struct timespec pass_start, pass_end;
+    char msg[600];
     
-    // Parser les arguments
-    while ((opt = getopt(argc, argv, "f:d:p:oh")) != -1) {
-        switch (opt) {
-            case 'f': filename = optarg; break;
-            case 'd': delay = atoi(optarg); break;
-            case 'p': port = optarg; break;
-            case 'o': one_shot = 1; break;
-            case 'h': print_usage(argv[0]); return 0;
-            default: print_usage(argv[0]); return 1;
-        }
+    // Parser les arguments (et trouver le fichier de configuration), puis
+    // fichier de configuration et arguments dans l'ordre
+    switch (parse_options(argc, argv, &config)) {
+        case 0: break;
+        case 1: print_usage(argv[0]); return 0;
+        default: print_usage(argv[0]); return 1;
+    }
+    if (config_build(argc, argv, &config) > 0) {
+        log_set_file(config.log_file);
+        log_message("FATAL", "Configuration invalide, arrêt");
+        return 1;
     }
+    delay = config.delay;
     
     // Setup signaux
     setup_signal_handlers();
+    if (minitel_init(&minitel) < 0) {
+        return 1;
+    }
+    config_apply(&config);
+    watchdog_arm(&minitel);
+    schedule_timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (schedule_timer_fd < 0 || event_loop_watch(&minitel, schedule_timer_fd, schedule_timer_read) < 0) {
+        log_message("ERROR", "Création de la minuterie des horaires impossible");
+        return 1;
+    }
+    config_watch(config_path);
     
     log_message("INFO", "=== Démarrage Minitel Sender (Production) ===");
-    snprintf(msg, sizeof(msg), "Port: %s, Fichier: %s, Délai: %dµs", port, filename, delay);
+    snprintf(msg, sizeof(msg), "Port: %s, Fichier: %s, Délai: %dµs", config.port, config.file, delay);
     log_message("INFO", msg);
     
+    // Fautes injectées sur le port (tests d'endurance: soak -f)
+    if (getenv("MINITEL_FAULTS") != NULL && port_faults_set(&minitel, getenv("MINITEL_FAULTS")) < 0) {
+        log_message("FATAL", "MINITEL_FAULTS invalide, arrêt");
+        return 1;
+    }
+    
+    // Fil d'écriture, seul en temps réel (-R, -A)
+    minitel.rt_policy = config.rt_policy;
+    minitel.rt_priority = config.rt_priority;
+    minitel.rt_cpu = config.rt_cpu;
+    if (output_init(&minitel, config.use_uring) < 0) {
+        return 1;
+    }
+    
+    // Premier écran: contenus préparés pendant que le port s'ouvre
+    if (!config.calibrate && schedule_current(&config, schedule_now()) >= 0) {
+        preload_start(&content, &image_content, schedule_current(&config, schedule_now()));
+    }
+    
     // Boucle principale avec reconnexion
-    while (keep_running) {
+    while (minitel.running) {
+        if (reload_requested) {
+            preload_join();
+            reload_requested = 0;
+            signals_log();
+            config_reload(argc, argv, &content, &image_content);
+        }
+        
+        // Hors des horaires d'ouverture: port fermé, sommeil jusqu'à l'ouverture
+        window = config.calibrate ? 0 : schedule_current(&config, schedule_now());
+        if (window < 0) {
+            if (!ready) {
+                sd_notify_send("READY=1");
+                ready = 1;
+            }
+            preload_join();
+            schedule_park(&content, &image_content);
+            page_index = 0;
+            continue;
+        }
+        metric_set(&minitel.metrics.schedule_open, 1);
+        schedule_arm(config.nwindows > 0 ? schedule_next_change(&config, schedule_now()) : 0);
+        schedule_due = 0;
+        
         // Ouvrir le port série
-        fd_global = open_serial_port(port);
+        minitel.fd = open_serial_port(config.port);
         
-        if (fd_global < 0) {
+        if (minitel.fd < 0) {
+            preload_join();
             retry_count++;
             
-            if (retry_count >= MAX_RETRIES) {
+            if (retry_count >= config.max_retries) {
                 log_message("FATAL", "Trop de tentatives échouées, arrêt");
+                sd_status("Port %s introuvable, arrêt", config.port);
                 return 1;
             }
             
             snprintf(msg, sizeof(msg), "Tentative %d/%d, attente %ds...", 
-                     retry_count, MAX_RETRIES, RETRY_DELAY);
+                     retry_count, config.max_retries, config.retry_delay);
             log_message("WARN", msg);
+            sd_status("Port %s absent, tentative %d/%d", config.port, retry_count, config.max_retries);
             
-            sleep(RETRY_DELAY);
+            // Attente volontaire: le watchdog ne doit pas expirer pendant ce temps
+            sd_notify_send("WATCHDOG=1");
+            sleep(config.retry_delay);
             continue;
         }
         
         // Reset compteur
         retry_count = 0;
-        reconnect_needed = 0;
+        minitel.reconnect = 0;
+        
+        // Identifier le terminal et caler le cadencement: calibrage
+        // enregistré pour ce port, sinon vitesse de la ligne
+        int probed = probe_terminal(&minitel, config.port, config.switch_speed) == 0;
+        delay = pacing_delay(&config, probed);
+        if (!config.calibrate && config.mirror_count > 0) {
+            snprintf(msg, sizeof(msg), "%d/%d port(s) miroir(s) ouvert(s)",
+                     mirrors_open(&minitel, config.mirrors, config.mirror_count), config.mirror_count);
+            log_message("INFO", msg);
+        }
+        event_loop_set_serial(&minitel, minitel.fd);
+        
+        // Ce qui était affiché avant la coupure, pour le redessiner tout de suite
+        static screen_cells_t previous;
+        previous = minitel.screen.cells;
         
         // Initialiser l'écran
-        if (init_minitel_screen(fd_global) < 0) {
-            close(fd_global);
-            fd_global = -1;
-            sleep(RETRY_DELAY);
+        int screen_ready = init_minitel_screen(&minitel);
+        preload_join();
+        if (screen_ready < 0) {
+            minitel_disconnect(&minitel);
+            sd_notify_send("WATCHDOG=1");
+            sleep(config.retry_delay);
             continue;
         }
         
+        if (!ready) {
+            sd_notify_send("READY=1");
+            ready = 1;
+        }
+        sd_status("%s à %d bauds sur %s", minitel.terminal.model, minitel.terminal.speed, config.port);
+        
+        if (config.page_mode) {
+            // L'écran vient d'être effacé: curseur masqué, puis page précédente
+            serial_write(&minitel, "\x14", 1);
+            if (send_frame(&minitel, &previous, delay) > 0) {
+                log_message("INFO", "Écran précédent redessiné");
+            }
+        }
+        
+        // Mode calibrage: mesurer, enregistrer, s'arrêter
+        if (config.calibrate) {
+            int best = calibrate_port(&minitel);
+            if (best > 0) {
+                snprintf(msg, sizeof(msg), "Délai retenu pour %s à %d bauds: %dµs (enregistré dans %s)",
+                         config.port, minitel.terminal.speed, best, CALIBRATION_FILE);
+                log_message("INFO", msg);
+                if (calibration_save(CALIBRATION_FILE, config.port, minitel.terminal.speed, best) < 0) {
+                    log_message("ERROR", "Impossible d'enregistrer le calibrage");
+                }
+            }
+            minitel.running = 0;
+        }
+        
         // Boucle d'envoi
-        printf("\n[DEBUG] === Boucle d'envoi, keep_running=%d, reconnect_needed=%d ===\n", keep_running, reconnect_needed);
-        while (keep_running && !reconnect_needed) {
-            // Watchdog
-            time_t now = time(NULL);
-            if (now - last_watchdog > WATCHDOG_TIMEOUT) {
-                log_message("INFO", "Watchdog: système vivant");
-                last_watchdog = now;
+        while (minitel.running && !minitel.reconnect) {
+            minitel.interrupt = 0;
+            
+            // Configuration modifiée (SIGHUP ou fichier réécrit): appliquée
+            // entre deux passes ou deux pages, le port reste ouvert
+            if (reload_requested) {
+                int page_mode = config.page_mode;
+                int r;
+                
+                reload_requested = 0;
+                signals_log();
+                r = config_reload(argc, argv, &content, &image_content);
+                if (r >= 0) {
+                    delay = pacing_delay(&config, probed);
+                    schedule_due = 1;  // les horaires ont pu changer
+                }
+                if (r > 0 || config.page_mode != page_mode) {
+                    page_index = 0;
+                    serial_write(&minitel, "\x0C", 1);
+                }
+            }
+            
+            // Changement d'horaire: fermeture, ou autre contenu pour la nouvelle plage
+            if (schedule_due) {
+                const char *file = schedule_file(&config, window);
+                
+                schedule_due = 0;
+                window = schedule_current(&config, schedule_now());
+                schedule_arm(config.nwindows > 0 ? schedule_next_change(&config, schedule_now()) : 0);
+                if (window < 0) {
+                    log_message("INFO", "Fin des horaires d'ouverture, mise en veille");
+                    output_detach(&minitel);
+                    serial_write(&minitel, "\x0C\x14", 2);  // écran effacé, curseur éteint
+                    break;
+                }
+                if (strcmp(file, schedule_file(&config, window)) != 0) {
+                    page_index = 0;
+                    serial_write(&minitel, "\x0C", 1);
+                }
+            }
+            
+            if (page_index == 0) {
+                clock_gettime(CLOCK_MONOTONIC, &pass_start);
+            }
+            
+            // Image d'intermède en début de passe
+            if (config.image[0] != '\0' && page_index == 0) {
+                if (show_interlude(&minitel, &image_content, config.image, delay, config.hold) < 0) {
+                    log_message("ERROR", "Erreur envoi image, reconnexion...");
+                    minitel.reconnect = 1;
+                    break;
+                }
+                if (!config.page_mode) {
+                    serial_write(&minitel, "\x0C", 1);
+                }
             }
             
-            printf("[DEBUG] Appel send_file_to_minitel...\n");
             // Envoyer le fichier
-            if (send_file_to_minitel(fd_global, filename, delay) < 0) {
-                printf("[DEBUG] send_file_to_minitel a retourné -1 (ERREUR)\n");
+            int result = config.page_mode
+                       ? send_pages_to_minitel(&minitel, &content, schedule_file(&config, window), delay,
+                                               config.hold, &page_index)
+                       : send_file_to_minitel(&minitel, &content, schedule_file(&config, window), delay);
+            if (result < 0) {
                 log_message("ERROR", "Erreur envoi, reconnexion...");
-                reconnect_needed = 1;
+                minitel.reconnect = 1;
                 break;
             }
             
-            printf("[DEBUG] send_file_to_minitel a retourné 0 (SUCCESS)\n");
+            if ((reload_requested || schedule_due) && page_index != 0) {
+                continue;  // passe interrompue (relecture, horaire), reprise à la page suivante
+            }
+            if (schedule_due) {
+                continue;
+            }
+            if (page_index == 0 && minitel.running && !minitel.reconnect) {
+                clock_gettime(CLOCK_MONOTONIC, &pass_end);
+                metric_set(&minitel.metrics.pass_duration_us, elapsed_us(&pass_start, &pass_end));
+                metric_add(&minitel.metrics.passes, 1);
+                if (!config.page_mode) {
+                    sd_status("Passe %llu terminée sur %s",
+                              (unsigned long long)atomic_load(&minitel.metrics.passes), config.port);
+                }
+            }
             
-            if (one_shot) {
-                printf("[DEBUG] Mode one-shot activé, arrêt\n");
+            if (config.one_shot) {
                 log_message("INFO", "Mode one-shot, arrêt");
-                keep_running = 0;
+                minitel.running = 0;
                 break;
             }
             
-            printf("[DEBUG] Attente 1 seconde avant reboucle...\n");
-            sleep(1);
+            event_wait(&minitel, (long)config.pass_pause * 1000, 0);
         }
         
-        printf("[DEBUG] Sortie boucle d'envoi: keep_running=%d, reconnect_needed=%d\n", keep_running, reconnect_needed);
-        
         // Fermer proprement
-        if (fd_global >= 0) {
-            close(fd_global);
-            fd_global = -1;
+        if (minitel.fd >= 0) {
+            minitel_disconnect(&minitel);
             log_message("INFO", "Port série fermé");
         }
         
-        if (reconnect_needed && keep_running) {
-            log_message("INFO", "Reconnexion dans 5s...");
-            sleep(5);
+        if (minitel.reconnect && minitel.running) {
+            metric_add(&minitel.metrics.reconnects, 1);
+            snprintf(msg, sizeof(msg), "Reconnexion dans %ds...", config.retry_delay);
+            log_message("INFO", msg);
+            sd_status("Port %s perdu, reconnexion", config.port);
+            sd_notify_send("WATCHDOG=1");
+            sleep(config.retry_delay);
         }
     }
     
+    preload_join();
+    signals_log();
+    sd_notify_send("STOPPING=1");
+    metrics_export(&minitel);
+    minitel_close(&minitel);
+    content_free(&content);
+    content_free(&image_content);
     log_message("INFO", "=== Arrêt propre du programme ===");
     
     return 0;
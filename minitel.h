@@ -0,0 +1,407 @@
+/**
+ * @file minitel.h
+ * @brief libminitel: port série, encodeur Vidéotex, mise en page et cadencement
+ * @author Creative Coding 2026
+ * @date 2026
+ * 
+ * Tout l'état d'un Minitel connecté tient dans un contexte minitel_t:
+ * port, modèle d'écran, boucle d'événements, fil d'écriture, métriques.
+ * Les fonctions d'encodage et de mise en page (screen_*, layout_pages,
+ * compile_markup, encode_frame...) n'en ont pas besoin: bancs d'essai et
+ * tests les appellent directement.
+ * 
+ * Utilisation:
+ *   minitel_t m;
+ *   minitel_init(&m);
+ *   output_init(&m, 0);
+ *   m.fd = open_serial_port("/dev/ttyUSB0");
+ *   probe_terminal(&m, "/dev/ttyUSB0", 0);
+ *   event_loop_set_serial(&m, m.fd);
+ *   init_minitel_screen(&m);
+ *   send_pages_to_minitel(&m, &content, "text.txt", 2083, 10, &page);
+ *   minitel_disconnect(&m);
+ *   minitel_close(&m);
+ * 
+ * Le journal (log_message), la notification systemd (sd_*) et le cache de
+ * la sonde sont propres au processus, pas au contexte.
+ */
+
+#ifndef MINITEL_H
+#define MINITEL_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define MINITEL_API_VERSION 2
+
+/* Réglages par défaut */
+#define CHARS_PER_LINE  10
+#define LINES_SKIP      30
+#define LOG_FILE        "/tmp/minitel.log"
+#define WATCHDOG_TIMEOUT 60
+#define DEFAULT_SPEED   4800
+#define CALIBRATION_FILE "minitel.calib"
+#define CACHE_DIR       "/var/cache/minitel"   // contenus encodés, gardés entre deux démarrages
+
+/* Mode page (écran Minitel 40x24, la rangée 0 est la ligne de service) */
+#define SCREEN_COLS     40
+#define SCREEN_ROWS     24
+#define SCREEN_CELLS    ((SCREEN_ROWS + 1) * SCREEN_COLS)
+#define PAGE_HOLD       10
+
+/* Clavier du Minitel: touches de fonction (SEP + code) */
+#define KEY_FUNCTION    0x100
+#define KEY_ENVOI       (KEY_FUNCTION | 0x41)
+#define KEY_RETOUR      (KEY_FUNCTION | 0x42)
+#define KEY_REPETITION  (KEY_FUNCTION | 0x43)
+#define KEY_GUIDE       (KEY_FUNCTION | 0x44)
+#define KEY_ANNULATION  (KEY_FUNCTION | 0x45)
+#define KEY_SOMMAIRE    (KEY_FUNCTION | 0x46)
+#define KEY_CORRECTION  (KEY_FUNCTION | 0x47)
+#define KEY_SUITE       (KEY_FUNCTION | 0x48)
+#define KEY_CONNEXION_FIN (KEY_FUNCTION | 0x49)
+
+/* Métriques (format texte Prometheus, collecteur textfile de node_exporter) */
+#define METRICS_FILE     "/tmp/minitel.prom"
+#define HIST_SUB_BITS    3     // 8 sous-seaux par puissance de 2: ±12,5 %
+#define HIST_SUB         (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP     26    // 2^26 µs, soit 67 s au plus
+#define HIST_BUCKETS     ((HIST_MAX_EXP - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* Ports miroirs, en plus du port principal */
+#define OUTPUT_MAX_MIRRORS 4
+
+/* Pire cas par cellule: US (3) + SO/SI et attributs (11) + glyphe (3) */
+#define FRAME_MAX_BYTES (SCREEN_CELLS * 17)
+
+/* Attributs de visualisation d'une cellule */
+#define ATTR_FG_MASK    0x0007
+#define ATTR_BG_SHIFT   3
+#define ATTR_BG_MASK    0x0038
+#define ATTR_BLINK      0x0040
+#define ATTR_INVERSE    0x0080
+#define ATTR_DBL_HEIGHT 0x0100
+#define ATTR_DBL_WIDTH  0x0200
+#define ATTR_G1         0x0400
+#define ATTR_DEFAULT    0x0007  // blanc sur noir, jeu G0
+
+/**
+ * @brief Contenu de l'écran en tableaux plats (rangée 0 incluse)
+ */
+typedef struct {
+    uint8_t  ch[SCREEN_CELLS];    // code du caractère G0 ou G1
+    uint8_t  g2[SCREEN_CELLS];    // code SS2 (accent ou caractère spécial), 0 sinon
+    uint16_t attr[SCREEN_CELLS];  // ATTR_*
+} screen_cells_t;
+
+/* Segment d'un passage pré-encodé */
+#define SEGMENT_PACED   0x01    // un créneau de cadencement par octet
+
+/**
+ * @brief Morceau d'un passage pré-encodé, désigné dans un tampon partagé
+ * 
+ * Une liste de segments ne change plus une fois construite: le fil
+ * d'écriture la rejoue par writev() directement depuis les tampons.
+ */
+typedef struct {
+    const uint8_t *base;
+    uint32_t len;
+    uint32_t flags;         // SEGMENT_*
+} output_segment_t;
+
+/**
+ * @brief Arène: blocs projetés (mmap) rendus au système d'un seul coup
+ * 
+ * Toutes les données d'une version de contenu (pages, flux compilé,
+ * segments) y sont prises; la version remplacée libère ses blocs en une
+ * fois, sans laisser de trous dans le tas au fil des rechargements.
+ */
+typedef struct {
+    struct arena_block *head;   // bloc courant, les précédents y sont chaînés
+    size_t used;            // octets alloués
+    size_t reserved;        // octets projetés (blocs et en-têtes)
+} arena_t;
+
+/**
+ * @brief Repère dans une arène: arena_release() revient à cet état
+ */
+typedef struct {
+    struct arena_block *block;
+    size_t top;
+    size_t used;
+} arena_mark_t;
+
+/* Types de contenu */
+typedef enum {
+    CONTENT_TEXT,
+    CONTENT_IMAGE,
+    CONTENT_ANIMATION
+} content_type_t;
+
+/**
+ * @brief Contenu prêt à afficher, gardé en cache tant que le fichier ne change pas
+ */
+typedef struct {
+    char path[256];
+    content_type_t type;
+    struct timespec mtime;  // à la nanoseconde: même taille, même seconde
+    ino_t ino;              // fichier remplacé par rename()
+    off_t size;
+    screen_cells_t *pages;  // pages de texte, image ou images d'une animation
+    int npages;
+    uint8_t *stream;        // textes: flux compilé pour le mode défilement
+    size_t stream_len;
+    output_segment_t *segments;  // textes: passage du mode défilement (content_segments)
+    int nsegments;
+    int segments_cols;      // chars_per_line et lines_skip du passage construit
+    int segments_skip;
+    int fps;                // animations: images par seconde
+    arena_t arena;          // mémoire de la version chargée
+    arena_mark_t segments_mark;  // état de l'arène avant les segments
+    void *cache_map;        // version reprise du cache disque: pages et flux projetés (mmap)
+    size_t cache_len;
+} content_t;
+
+/**
+ * @brief Capacités du terminal, d'après sa réponse à ENQROM
+ */
+typedef struct {
+    char port[128];
+    int probed;             // 1 si le Minitel a répondu
+    uint8_t rom[3];         // constructeur, modèle, version
+    const char *model;
+    int speed;              // vitesse actuelle (bauds)
+    int max_speed;
+    int cols80;             // mode 80 colonnes (téléinformatique)
+    int drcs;               // jeu de caractères redéfinissables
+} terminal_caps_t;
+
+/**
+ * @brief Modèle de l'écran du Minitel, tenu à jour octet par octet
+ */
+typedef struct {
+    screen_cells_t cells;
+    int row;                // curseur: rangée 0..24
+    int col;                // curseur: colonne 0..39
+    uint16_t cur_attr;      // attributs courants (ATTR_G1 = mode semi-graphique)
+    int cursor_visible;
+    int state;              // état du décodeur Vidéotex
+    int skip;
+    uint8_t seq;
+    uint8_t last_ch;
+    uint64_t bytes;
+    uint64_t glyphs;        // caractères posés à l'écran (répétitions comprises)
+} minitel_screen_t;
+
+/**
+ * @brief Histogramme log-linéaire à la HDR, en microsecondes
+ * 
+ * Seaux exacts sous HIST_SUB µs, puis HIST_SUB seaux par puissance de 2.
+ * Taille fixe, mise à jour par additions atomiques: ni allocation ni verrou.
+ */
+typedef struct {
+    _Atomic uint64_t counts[HIST_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;   // µs
+    _Atomic uint64_t max;   // µs
+} histogram_t;
+
+/**
+ * @brief Registre des métriques, exporté périodiquement
+ */
+typedef struct {
+    _Atomic uint64_t bytes_sent;
+    _Atomic uint64_t glyphs_sent;
+    _Atomic uint64_t passes;
+    _Atomic uint64_t pages_sent;
+    _Atomic uint64_t frames_dropped;
+    _Atomic uint64_t reconnects;
+    _Atomic uint64_t write_errors;
+    _Atomic uint64_t faults_injected;   // port_faults_set(): tests seulement
+    _Atomic uint64_t pacing_overruns;   // octets partis après leur créneau
+    _Atomic int64_t  pacing_target_rate;   // octets/s visés (dernière rafale)
+    _Atomic int64_t  pacing_actual_rate;   // octets/s mesurés (dernière rafale)
+    _Atomic int64_t  pacing_drift_ppm;     // écart du rythme réel, en millionièmes
+    _Atomic int64_t  queue_depth;       // octets en attente dans le pilote série
+    _Atomic int64_t  offset;            // position dans le flux, ou page affichée
+    _Atomic int64_t  pass_duration_us;  // durée de la dernière passe
+    _Atomic int64_t  first_glyph_us;    // du lancement au premier caractère affiché, 0 avant
+    _Atomic int64_t  schedule_open;     // 1 pendant les horaires d'ouverture
+    histogram_t write_latency;          // durée de l'appel write()
+    histogram_t pacing_error;           // retard du réveil sur l'échéance
+} metrics_t;
+
+/**
+ * @brief Rafale cadencée: créneaux à échéance absolue et bilan de précision
+ */
+typedef struct {
+    metrics_t *metrics;     // registre mis à jour par la rafale
+    struct timespec start;
+    struct timespec slot;   // échéance du créneau courant
+    long delay;             // µs par créneau
+    unsigned long slots;
+    unsigned long overruns;
+    unsigned long resyncs;
+    uint64_t bytes;         // metrics->bytes_sent au départ, puis octets émis
+    struct timespec end;
+} pacer_t;
+
+/* Boucle d'événements et fil d'écriture (privés à la bibliothèque) */
+struct minitel_engine;
+
+/**
+ * @brief Un Minitel piloté: port, écran, demandes en cours, réglages
+ * 
+ * Les demandes (running, reconnect, interrupt, dump) sont de simples
+ * drapeaux: un gestionnaire de signal peut les lever.
+ */
+typedef struct minitel {
+    int fd;                         // port principal, -1 si fermé
+    terminal_caps_t terminal;       // terminal identifié par probe_terminal()
+    minitel_screen_t screen;        // ce que le Minitel affiche, d'après les octets émis
+    /* Demandes */
+    volatile sig_atomic_t running;  // 0: arrêt demandé
+    volatile sig_atomic_t reconnect;  // port perdu: à fermer puis rouvrir
+    volatile sig_atomic_t interrupt;  // passe à écourter (relecture, changement d'horaire)
+    volatile sig_atomic_t dump;     // capture de l'écran demandée
+    /* Réglages */
+    int chars_per_line;             // défilement: retour à la ligne tous les n caractères
+    int lines_skip;                 // défilement: lignes sautées en fin de passe
+    int watchdog_timeout;           // s entre deux signes de vie, hors systemd
+    int rt_policy;                  // fil d'écriture: SCHED_FIFO ou SCHED_RR (output_init)
+    int rt_priority;                // 0: temps partagé
+    int rt_cpu;                     // cœur du fil d'écriture, -1: pas d'épinglage
+    char metrics_file[256];         // "" : export coupé
+    metrics_t metrics;
+    struct minitel_engine *engine;
+} minitel_t;
+
+/* Descripteur supplémentaire servi par la boucle d'événements */
+typedef void (*event_handler_t)(minitel_t *m, int fd);
+
+/**
+ * @brief Compteur: ajoute n
+ */
+static inline void metric_add(_Atomic uint64_t *counter, uint64_t n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+/**
+ * @brief Jauge: fixe la valeur
+ */
+static inline void metric_set(_Atomic int64_t *gauge, int64_t value) {
+    atomic_store_explicit(gauge, value, memory_order_relaxed);
+}
+
+/**
+ * @brief Écart entre deux instants, en µs
+ */
+static inline int64_t elapsed_us(const struct timespec *from, const struct timespec *to) {
+    return (int64_t)(to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+/* Contexte */
+int minitel_init(minitel_t *m);
+void minitel_disconnect(minitel_t *m);
+void minitel_close(minitel_t *m);
+
+/* Journal et systemd (processus) */
+void log_set_file(const char *path);
+void log_message(const char *level, const char *message);
+int sd_notify_send(const char *state);
+void sd_status(const char *format, ...);
+long sd_watchdog_usec(void);
+int realtime_setup(pthread_t thread, int policy, int priority, int cpu);
+
+/* Modèle d'écran et encodeur Vidéotex */
+void screen_reset(minitel_screen_t *scr);
+void screen_feed(minitel_screen_t *scr, const uint8_t *buf, size_t len);
+int screen_dump(const minitel_screen_t *scr, const char *path);
+size_t encode_attr_change(uint16_t cur, uint16_t want, uint8_t *out);
+size_t encode_frame_diff(const minitel_screen_t *from, const screen_cells_t *to, uint8_t *out);
+size_t encode_frame(const minitel_screen_t *from, const screen_cells_t *to, uint8_t *out);
+
+/* Texte, mise en page, images */
+char *load_text_file(const char *filename, size_t *len);
+int utf8_decode(const unsigned char *s, size_t len, uint32_t *cp);
+size_t utf8_sanitize(char *text, size_t len, size_t *first_invalid);
+uint16_t videotex_glyph(uint32_t cp);
+size_t markup_tag(const char *s, size_t len, uint16_t *attr);
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+arena_mark_t arena_mark(const arena_t *arena);
+void arena_release(arena_t *arena, arena_mark_t mark);
+void arena_free(arena_t *arena);
+void arena_stats(size_t *reserved, size_t *peak);
+int layout_pages(arena_t *arena, const char *text, size_t len, screen_cells_t **pages_out);
+uint8_t *compile_markup(arena_t *arena, const char *text, size_t len, size_t *out_len);
+uint8_t *load_pnm_image(const char *filename, int *width, int *height);
+int mosaic_from_image(const uint8_t *pixels, int width, int height, screen_cells_t *frame);
+void content_cache_set_dir(const char *dir);
+int content_load(content_t *content, const char *path);
+void content_free(content_t *content);
+int content_segments(content_t *content, int cols, int skip);
+int build_index_page(const content_t *content, const char *choice, screen_cells_t *index, int *targets);
+
+/* Métriques */
+void hist_record(histogram_t *h, uint64_t v);
+int metrics_export(minitel_t *m);
+
+/* Boucle d'événements et clavier */
+int event_loop_watch(minitel_t *m, int fd, event_handler_t handler);
+void event_loop_set_serial(minitel_t *m, int fd);
+int event_wait_until(minitel_t *m, const struct timespec *deadline, int wake_on_key);
+int event_wait(minitel_t *m, long usec, int wake_on_key);
+void screen_dump_if_requested(minitel_t *m);
+const char *key_name(int key);
+void keyboard_feed(minitel_t *m, uint8_t b);
+int key_pop(minitel_t *m);
+void key_flush(minitel_t *m);
+void watchdog_kick(minitel_t *m);
+int watchdog_arm(minitel_t *m);
+
+/* Cadencement */
+void pacer_start(pacer_t *pacer, metrics_t *metrics, long delay);
+void pacer_next(pacer_t *pacer);
+int pacer_wait(minitel_t *m, pacer_t *pacer, int wake_on_key);
+void pacer_stop(pacer_t *pacer);
+void pacer_report(const pacer_t *pacer, const char *what);
+void pacer_finish(pacer_t *pacer, const char *what);
+
+/* Port série et fil d'écriture */
+int open_serial_port(const char *port);
+int check_serial_connection(int fd);
+int mirrors_open(minitel_t *m, const char *ports[], int count);
+void mirrors_close(minitel_t *m);
+int output_init(minitel_t *m, int use_uring);
+void output_shutdown(minitel_t *m);
+int output_flush(minitel_t *m);
+int output_drain(minitel_t *m, int timeout_ms);
+int output_queue(minitel_t *m, const void *buf, size_t len, long delay);
+int output_replay(minitel_t *m, const output_segment_t *segs, int count, long delay, uint64_t *sent);
+void output_detach(minitel_t *m);
+ssize_t serial_write(minitel_t *m, const void *buf, size_t len);
+int port_faults_set(minitel_t *m, const char *spec);
+
+/* Terminal */
+int probe_terminal(minitel_t *m, const char *port, int switch_speed);
+int calibration_load(const char *path, const char *port, int speed);
+int calibration_save(const char *path, const char *port, int speed, int delay);
+int calibrate_port(minitel_t *m);
+int init_minitel_screen(minitel_t *m);
+
+/* Affichage */
+int send_encoded(minitel_t *m, const uint8_t *buf, size_t len, int delay);
+int send_frame(minitel_t *m, const screen_cells_t *frame, int delay);
+int play_animation(minitel_t *m, const content_t *anim, int delay);
+int show_interlude(minitel_t *m, content_t *interlude, const char *path, int delay, int hold);
+int run_index(minitel_t *m, const content_t *content, int current, int delay, int hold);
+int send_file_to_minitel(minitel_t *m, content_t *content, const char *filename, int delay);
+int send_pages_to_minitel(minitel_t *m, content_t *content, const char *filename, int delay, int hold, int *page_index);
+
+#endif /* MINITEL_H */
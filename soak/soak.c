@@ -0,0 +1,577 @@
+/**
+ * @file soak.c
+ * @brief Test d'endurance: le programme face à un Minitel simulé sur un pty
+ * @author Creative Coding 2026
+ * @date 2026
+ *
+ * Le harnais joue le Minitel (il répond à la sonde ENQROM et lit tout ce
+ * qui arrive) et lance le programme à pleine vitesse: délai nul, passes
+ * enchaînées. Pendant l'essai, il injecte au hasard:
+ *   - des déconnexions (le maître du pty est fermé puis recréé)
+ *   - des changements du fichier texte (deux versions de même taille)
+ *   - des relectures de configuration (fichier réécrit puis SIGHUP)
+ *   - des vidages d'écran (SIGUSR1)
+ * et relève toutes les SAMPLE secondes la mémoire résidente, les
+ * descripteurs ouverts, les passes et la durée de la dernière passe
+ * (fichier de métriques). L'essai échoue si le programme s'arrête, si les
+ * passes n'avancent plus, si le dernier tiers de l'essai est tout entier
+ * au-dessus du premier (RSS, descripteurs, arène), ou si ses passes sont
+ * nettement plus lentes (durée moyenne, d'après le nombre de passes).
+ * Avec -f, le programme écrit en plus à travers des fautes injectées
+ * (MINITEL_FAULTS, voir port_faults_set()), par exemple
+ * -f eagain=5,eintr=5,partial=20,stall=0.1,eio=0.001.
+ *
+ *   soak [-t DURÉE] [-e ÉVÉNEMENTS] [-i RELEVÉ] [-s GRAINE] [-r KO] [-l FACTEUR] [-f FAUTES] [./minitel]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define SOAK_DURATION   600     // s
+#define SOAK_EVENTS     5       // s entre deux événements injectés, en moyenne
+#define SOAK_SAMPLE     10      // s entre deux relevés (période d'export des métriques)
+#define SOAK_PHASE      2.5     // s: relevés décalés des exports, faits toutes les 10 s depuis le lancement
+#define SOAK_WARMUP     2       // relevés ignorés au démarrage
+#define SOAK_MIN_SAMPLES 6      // relevés nécessaires pour juger une tendance
+#define SOAK_MIN_THIRD  5       // relevés par tiers nécessaires pour juger la durée des passes
+#define SOAK_STALL      30      // s sans nouvelle passe: programme bloqué
+#define SOAK_LOG_MAX    (64L << 20)  // journal vidé au-delà (une ligne par passe)
+#define SOAK_RSS_SLACK  512     // Ko de RSS tolérés entre début et fin
+#define SOAK_LATENCY    2.0     // ralentissement toléré de la durée moyenne de passe
+#define SOAK_LATENCY_FLOOR 0.002  // s: en dessous, l'écart n'est que du bruit
+#define SOAK_STOP_MS    5000    // délai accordé à l'arrêt propre
+
+/**
+ * @brief Relevé périodique du programme testé
+ */
+typedef struct {
+    double t;               // s depuis le départ
+    long rss_kb;
+    int fds;
+    double passes;
+    double pass_s;          // durée de la dernière passe
+    double arena;           // octets des arènes de contenu
+    double reconnects;
+} sample_t;
+
+/* Deux versions du texte de même taille: seul l'horodatage (à la
+ * nanoseconde) dit au programme que le fichier a changé */
+static const char text_first[] =
+    "{dbl}Endurance{/}\n"
+    "Le harnais ferme le port, change ce texte et relit la configuration. "
+    "Accents: é à ç ê œ « guillemets » et {inv}inversion{/inv}, {c:3}couleur{/}.\n"
+    "Une longue ligne qui dépasse largement les quarante colonnes de l'écran "
+    "pour obliger la coupure des lignes à chaque passe.\n";
+static const char text_second[] =
+    "{dh}Seconde version{/}\n"
+    "Même taille que la première, octet pour octet: seul l'horodatage fin du fichier la distingue.\n"
+    "Avec {blink}clignotement{/blink} et {{accolades}}, puis {c:5}couleur{/}, sur des lignes courtes.\n"
+    "Une autre mise en page,\n"
+    "ainsi d'autres pages,\n"
+    "et d'autres segments du passage !\n";
+_Static_assert(sizeof(text_first) == sizeof(text_second), "les deux versions doivent avoir la même taille");
+
+static const char *const texts[2] = { text_first, text_second };
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static char dir[64];
+static char link_path[128];
+static char text_path[128];
+static char conf_path[128];
+static char metrics_path[128];
+static int master = -1;
+static int slave = -1;      // gardé ouvert: le maître ne voit pas de raccroché entre deux connexions
+static int probe_state = 0;
+static uint64_t bytes_read = 0;
+
+/**
+ * @brief Générateur xorshift64* (reproductible avec -s)
+ */
+static uint64_t rng(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Écrit un fichier d'un coup (fichier temporaire puis renommage)
+ */
+static int write_file(const char *path, const char *data) {
+    char tmp[160];
+    FILE *file;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    file = fopen(tmp, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    fputs(data, file);
+    if (fclose(file) != 0) {
+        return -1;
+    }
+    return rename(tmp, path);
+}
+
+/**
+ * @brief Écrit la configuration du programme testé
+ */
+static int write_config(int cols) {
+    char conf[1024];
+
+    snprintf(conf, sizeof(conf),
+             "port = %s\nfile = %s\nlog_file = %s/minitel.log\nmetrics_file = %s\n"
+             "cache_dir = %s/cache\n"
+             "delay = 0\npass_pause = 0\nchars_per_line = %d\n"
+             "max_retries = 10000\nretry_delay = 1\n",
+             link_path, text_path, dir, metrics_path, dir, cols);
+    return write_file(conf_path, conf);
+}
+
+/**
+ * @brief Crée un nouveau pty et y fait pointer le lien du port
+ */
+static int pty_open(void) {
+    char *name;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0 || (name = ptsname(master)) == NULL) {
+        perror("pty");
+        return -1;
+    }
+    slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    unlink(link_path);
+    if (symlink(name, link_path) < 0) {
+        perror(link_path);
+        return -1;
+    }
+    probe_state = 0;
+    return 0;
+}
+
+/**
+ * @brief Débranchement: le port disparaît puis revient sur un autre pty
+ */
+static int pty_unplug(void) {
+    struct timespec gap = { 0, 50 * 1000000L };
+
+    unlink(link_path);
+    close(master);
+    close(slave);
+    master = -1;
+    nanosleep(&gap, NULL);
+    return pty_open();
+}
+
+/**
+ * @brief Lit ce que le programme envoie, et répond comme un Minitel 1B
+ *
+ * ESC 9 { (ENQROM): SOH, constructeur, modèle 'u', version, EOT.
+ * ESC 9 t (STATUS VITESSE): ESC : u et le code de 4800 bauds.
+ */
+static void pty_drain(int timeout_ms) {
+    static const uint8_t rom[] = { 0x01, 'C', 'u', '4', 0x04 };
+    static const uint8_t speed[] = { 0x1B, 0x3A, 0x75, 0x64 };
+    struct pollfd pfd = { master, POLLIN, 0 };
+    uint8_t buf[65536];
+    ssize_t n;
+
+    if (poll(&pfd, 1, timeout_ms) <= 0 || !(pfd.revents & POLLIN)) {
+        return;
+    }
+    while ((n = read(master, buf, sizeof(buf))) > 0) {
+        bytes_read += (uint64_t)n;
+        for (ssize_t i = 0; i < n; i++) {
+            ssize_t written = 0;
+
+            if (probe_state == 2 && buf[i] == 0x7B) {
+                written = write(master, rom, sizeof(rom));
+            } else if (probe_state == 2 && buf[i] == 0x74) {
+                written = write(master, speed, sizeof(speed));
+            }
+            (void)written;
+            probe_state = buf[i] == 0x1B ? 1 : (probe_state == 1 && buf[i] == 0x39) ? 2 : 0;
+        }
+    }
+}
+
+/**
+ * @brief Valeur d'une métrique du fichier d'export (-1 si absente)
+ */
+static double metric(const char *text, const char *name) {
+    size_t len = strlen(name);
+
+    for (const char *line = text; line != NULL && *line != '\0'; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (strncmp(line, name, len) == 0 && line[len] == ' ') {
+            return strtod(line + len + 1, NULL);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Relève la mémoire, les descripteurs et les métriques du programme
+ */
+static void take_sample(pid_t pid, double t, sample_t *s) {
+    char path[64];
+    char text[65536];
+    size_t n = 0;
+    FILE *file;
+    DIR *fds;
+    struct dirent *entry;
+
+    memset(s, 0, sizeof(*s));
+    s->t = t;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    file = fopen(path, "r");
+    while (file != NULL && fgets(text, sizeof(text), file) != NULL) {
+        sscanf(text, "VmRSS: %ld", &s->rss_kb);
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    fds = opendir(path);
+    while (fds != NULL && (entry = readdir(fds)) != NULL) {
+        s->fds += entry->d_name[0] != '.';
+    }
+    if (fds != NULL) {
+        closedir(fds);
+    }
+
+    file = fopen(metrics_path, "r");
+    if (file != NULL) {
+        n = fread(text, 1, sizeof(text) - 1, file);
+        fclose(file);
+    }
+    text[n] = '\0';
+    s->passes = metric(text, "minitel_passes_total");
+    s->pass_s = metric(text, "minitel_pass_duration_seconds");
+    s->arena = metric(text, "minitel_content_arena_bytes");
+    s->reconnects = metric(text, "minitel_reconnects_total");
+}
+
+/**
+ * @brief Durée moyenne d'une passe entre le premier et le dernier relevé
+ *
+ * D'après le compteur de passes plutôt que la jauge de la dernière passe,
+ * qui saute d'une passe à l'autre (écran vidé, texte rechargé).
+ * @return s par passe, -1 si aucune passe
+ */
+static double mean_pass(const sample_t *s, int n) {
+    double passes = s[n - 1].passes - s[0].passes;
+
+    return passes > 0 ? (s[n - 1].t - s[0].t) / passes : -1;
+}
+
+/**
+ * @brief Croissance: le dernier tiers entier au-dessus du premier tiers
+ *
+ * Comparer le minimum de la fin au maximum du début ignore les pics
+ * (rechargement, reconnexion) et ne retient qu'un niveau qui a monté.
+ */
+#define GROWTH(field, early, late, n, slack, what, unit) do { \
+        double hi = (early)[0].field, lo = (late)[0].field; \
+        for (int k = 1; k < (n); k++) { \
+            if ((early)[k].field > hi) hi = (early)[k].field; \
+            if ((late)[k].field < lo) lo = (late)[k].field; \
+        } \
+        if (lo > hi + (slack)) { \
+            fprintf(stderr, "ÉCHEC: %s en hausse: %.0f " unit " au début, au moins %.0f " unit " à la fin\n", \
+                    what, hi, lo); \
+            failed = 1; \
+        } \
+    } while (0)
+
+/**
+ * @brief Juge la tendance des relevés, hors mise en route
+ *
+ * Les relevés sans métriques (pas encore d'export) sont écartés.
+ * @return 0 si rien n'a grandi, 1 sinon
+ */
+static int judge(const sample_t *samples, int count, double rss_slack, double latency) {
+    sample_t s[count > 0 ? count : 1];
+    int n = 0;
+    int third;
+    int failed = 0;
+    double early_pass, late_pass;
+
+    for (int i = SOAK_WARMUP; i < count; i++) {
+        if (samples[i].passes >= 0 && samples[i].pass_s >= 0 && samples[i].arena >= 0) {
+            s[n++] = samples[i];
+        }
+    }
+    if (n < SOAK_MIN_SAMPLES) {
+        printf("Essai trop court pour juger une tendance (%d relevé(s) utiles, %d nécessaires)\n",
+               n, SOAK_MIN_SAMPLES);
+        return 0;
+    }
+
+    third = n / 3;
+    GROWTH(rss_kb, s, s + n - third, third, rss_slack, "mémoire résidente", "Ko");
+    GROWTH(fds, s, s + n - third, third, 0, "descripteurs ouverts", "fd");
+    GROWTH(arena, s, s + n - third, third, 0, "arènes de contenu", "octets");
+
+    if (third < SOAK_MIN_THIRD) {
+        printf("Durée des passes non jugée (%d relevé(s) par tiers, %d nécessaires)\n", third, SOAK_MIN_THIRD);
+        return failed;
+    }
+    early_pass = mean_pass(s, third);
+    late_pass = mean_pass(s + n - third, third);
+    if (early_pass > 0 && late_pass > early_pass * latency && late_pass - early_pass > SOAK_LATENCY_FLOOR) {
+        fprintf(stderr, "ÉCHEC: passes plus lentes: %.2f ms au début, %.2f ms à la fin\n",
+                early_pass * 1e3, late_pass * 1e3);
+        failed = 1;
+    }
+    return failed;
+}
+
+/**
+ * @brief Arrête le programme (SIGTERM) et vérifie qu'il sort proprement
+ * @return 0 si arrêt propre dans les temps
+ */
+static int stop_child(pid_t pid) {
+    int status;
+
+    kill(pid, SIGTERM);
+    for (int waited = 0; waited < SOAK_STOP_MS; waited += 10) {
+        pty_drain(10);
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                return 0;
+            }
+            fprintf(stderr, "ÉCHEC: arrêt avec le statut %#x\n", status);
+            return -1;
+        }
+    }
+    fprintf(stderr, "ÉCHEC: pas d'arrêt %d ms après SIGTERM\n", SOAK_STOP_MS);
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    double duration = SOAK_DURATION;
+    double event_mean = SOAK_EVENTS;
+    double interval = SOAK_SAMPLE;
+    double rss_slack = SOAK_RSS_SLACK;
+    double latency = SOAK_LATENCY;
+    const char *program = "./minitel";
+    const char *faults = NULL;
+    int first = 1;
+    sample_t *samples;
+    int max_samples, count = 0;
+    int unplugs = 0, edits = 0, reloads = 0, dumps = 0;
+    int version = 0, cols = 40;
+    double progress_t;
+    double last_passes = -1;
+    char log_path[160];
+    int failed = 0;
+    double start, next_event, next_sample;
+    pid_t pid;
+    int status;
+
+    while (first + 1 < argc && argv[first][0] == '-') {
+        double value = atof(argv[first + 1]);
+
+        switch (argv[first][1]) {
+            case 't': duration = value; break;
+            case 'e': event_mean = value; break;
+            case 'i': interval = value; break;
+            case 'r': rss_slack = value; break;
+            case 'l': latency = value; break;
+            case 'f': faults = argv[first + 1]; break;
+            case 's':
+                rng_state = strtoull(argv[first + 1], NULL, 0);
+                if (rng_state == 0) {
+                    rng_state = 1;  // xorshift reste à zéro
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t DURÉE] [-e ÉVÉNEMENTS] [-i RELEVÉ] [-s GRAINE] "
+                        "[-r KO] [-l FACTEUR] [-f FAUTES] [./minitel]\n", argv[0]);
+                return 2;
+        }
+        first += 2;
+    }
+    if (first < argc) {
+        program = argv[first];
+    }
+    if (interval <= 0 || event_mean <= 0) {
+        fprintf(stderr, "Relevé et événements: durées positives\n");
+        return 2;
+    }
+
+    snprintf(dir, sizeof(dir), "/tmp/minitel-soak.XXXXXX");
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(link_path, sizeof(link_path), "%s/tty", dir);
+    snprintf(text_path, sizeof(text_path), "%s/text.txt", dir);
+    snprintf(conf_path, sizeof(conf_path), "%s/minitel.conf", dir);
+    snprintf(metrics_path, sizeof(metrics_path), "%s/minitel.prom", dir);
+    snprintf(log_path, sizeof(log_path), "%s/minitel.log", dir);
+    if (write_file(text_path, texts[0]) < 0 || write_config(cols) < 0 || pty_open() < 0) {
+        return 1;
+    }
+
+    max_samples = (int)(duration / interval) + 2;
+    samples = calloc((size_t)max_samples, sizeof(sample_t));
+    if (samples == NULL) {
+        return 1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        char log[160];
+        int err;
+
+        snprintf(log, sizeof(log), "%s/stderr.txt", dir);
+        err = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(null, STDOUT_FILENO);
+        dup2(err >= 0 ? err : null, STDERR_FILENO);
+        close(null);
+        if (err >= 0) {
+            close(err);
+        }
+        setpgid(0, 0);  // pas de Ctrl+C direct: le harnais arrête lui-même
+        if (faults != NULL) {
+            setenv("MINITEL_FAULTS", faults, 1);
+        }
+        execl(program, program, "-c", conf_path, (char *)NULL);
+        _exit(127);
+    }
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Endurance: %s, %.0f s, un événement toutes les %.1f s en moyenne, graine %#llx\n",
+           program, duration, event_mean, (unsigned long long)rng_state);
+    if (faults != NULL) {
+        printf("Fautes injectées: %s\n", faults);
+    }
+    printf("Fichiers: %s\n", dir);
+    printf("%8s %10s %9s %9s %5s %9s %9s %6s\n",
+           "t (s)", "passes", "passes/s", "RSS (Ko)", "fd", "passe ms", "arène Ko", "reco.");
+
+    start = now_s();
+    progress_t = start;
+    next_event = start + event_mean * (0.5 + (double)(rng() % 1000) / 1000.0);
+    next_sample = start + interval + SOAK_PHASE;
+
+    while (!failed && now_s() - start < duration) {
+        double t = now_s();
+
+        pty_drain(10);
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            fprintf(stderr, "ÉCHEC: le programme s'est arrêté (statut %#x), voir %s\n", status, dir);
+            return 1;
+        }
+
+        if (t >= next_event) {
+            switch (rng() % 4) {
+                case 0:
+                    failed = pty_unplug() < 0;
+                    unplugs++;
+                    break;
+                case 1:
+                    version = !version;
+                    write_file(text_path, texts[version]);
+                    edits++;
+                    break;
+                case 2:
+                    cols = cols == 40 ? 39 : 40;  // segments du passage reconstruits
+                    write_config(cols);
+                    kill(pid, SIGHUP);
+                    reloads++;
+                    break;
+                default:
+                    kill(pid, SIGUSR1);
+                    dumps++;
+                    break;
+            }
+            next_event = t + event_mean * (0.5 + (double)(rng() % 1000) / 1000.0);
+        }
+
+        if (t >= next_sample && count < max_samples) {
+            sample_t *s = &samples[count];
+            struct stat st;
+            double rate = 0;
+
+            take_sample(pid, t - start, s);
+            if (count > 0 && s->passes >= 0 && samples[count - 1].passes >= 0) {
+                rate = (s->passes - samples[count - 1].passes) / (s->t - samples[count - 1].t);
+            }
+            if (s->passes > last_passes) {
+                last_passes = s->passes;
+                progress_t = t;
+            }
+            if (s->passes < 0) {
+                printf("%8.0f %10s %9s %9ld %5d %9s %9s %6s\n", s->t, "-", "-", s->rss_kb, s->fds, "-", "-", "-");
+            } else {
+                printf("%8.0f %10.0f %9.0f %9ld %5d %9.3f %9.0f %6.0f\n", s->t, s->passes, rate,
+                       s->rss_kb, s->fds, s->pass_s * 1e3, s->arena / 1024, s->reconnects);
+            }
+            fflush(stdout);
+            count++;
+            next_sample += interval;
+
+            if (t - progress_t >= SOAK_STALL) {
+                fprintf(stderr, "ÉCHEC: aucune passe depuis %.0f s, voir %s\n", t - progress_t, dir);
+                failed = 1;
+            }
+
+            // Le programme journalise chaque passe: garder le disque, pas l'historique
+            if (stat(log_path, &st) == 0 && st.st_size > SOAK_LOG_MAX) {
+                truncate(log_path, 0);
+            }
+        }
+    }
+
+    if (stop_child(pid) < 0) {
+        failed = 1;
+    }
+    if (!failed) {
+        failed = judge(samples, count, rss_slack, latency);
+    }
+
+    printf("%d débranchement(s), %d modification(s) du texte, %d relecture(s), %d vidage(s), "
+           "%llu octets reçus\n", unplugs, edits, reloads, dumps, (unsigned long long)bytes_read);
+    if (failed) {
+        fprintf(stderr, "Endurance: ÉCHEC (journal et métriques dans %s)\n", dir);
+        free(samples);
+        return 1;
+    }
+    printf("Endurance: aucune croissance ni blocage détecté\n");
+    free(samples);
+    return 0;
+}